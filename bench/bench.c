@@ -0,0 +1,229 @@
+/*
+Render benchmark for the rings face. main.c is compiled in directly so the
+update procs can be called one at a time against the software GContext.
+Every platform binary sweeps all 720 hour/minute states of a 12 hour dial
+in clock order, ticking the face first the way the firmware would, and
+times each update proc in isolation plus a full window frame.
+
+Pixel counts are deterministic and are the number to diff between runs;
+nanosecond figures depend on the host and are only comparable on the same
+machine.
+
+-s draws the rings with the span table renderer instead of
+graphics_fill_radial, and -d compares the two pixel by pixel over every
+state. Span fills write the framebuffer directly, so they do not show in
+the pixel counts.
+*/
+
+#include <stdbool.h>
+#include <unistd.h>
+
+static bool bench_span_rings;
+#define span_rings bench_span_rings
+
+#define main rings_main
+#include "../src/c/main.c"
+#undef main
+
+#define num_states (12 * 60)
+#define bench_epoch 1767571200  //Mon 2026-01-05 00:00:00 UTC
+
+typedef struct {
+  const char *name;
+  uint64_t best_ns[num_states];
+  uint32_t pixels[num_states];
+  uint32_t radial_fills;
+} ProcStats;
+
+enum { PROC_RING, PROC_BATTERY, PROC_BT_ICON, PROC_LINE, PROC_FRAME, NUM_PROCS };
+
+static ProcStats stats[NUM_PROCS] = {
+  [PROC_RING] = { .name = "ring_update_proc" },
+  [PROC_BATTERY] = { .name = "battery_update_proc" },
+  [PROC_BT_ICON] = { .name = "bt_icon_update_proc" },
+  [PROC_LINE] = { .name = "line_update_proc" },
+  [PROC_FRAME] = { .name = "frame" },
+};
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void tick_to(int state) {
+  time_t t = bench_epoch + state * 60;
+  stub_set_time(t);
+  struct tm *tick_time = localtime(&t);
+  TimeUnits units = MINUTE_UNIT;
+  if(tick_time->tm_min == 0) units |= HOUR_UNIT;
+  if((tick_time->tm_min == 0) && (tick_time->tm_hour == 0)) units |= DAY_UNIT;
+  stub_tick_handler()(tick_time, units);
+}
+
+static void measure(int proc, int state, Layer *layer) {
+  ProcStats *s = &stats[proc];
+  uint32_t pixels_before = stub_counters.pixels;
+  uint32_t radial_before = stub_counters.fill_radial;
+  uint64_t start = now_ns();
+  if(layer) stub_draw_layer(layer);
+  else stub_render();
+  uint64_t elapsed = now_ns() - start;
+  if(!s->best_ns[state] || (elapsed < s->best_ns[state])) s->best_ns[state] = elapsed;
+  s->pixels[state] = stub_counters.pixels - pixels_before;
+  s->radial_fills += stub_counters.fill_radial - radial_before;
+}
+
+static void report(bool csv, int passes) {
+  if(csv) printf("platform,proc,mean_ns,max_ns,worst_state,mean_pixels,max_pixels,radial_fills\n");
+  else printf("%-8s %-20s %10s %10s %6s %11s %10s %8s\n",
+              "platform", "proc", "mean_ns", "max_ns", "worst", "mean_px", "max_px", "radials");
+
+  for(int p = 0; p < NUM_PROCS; p++) {
+    ProcStats *s = &stats[p];
+    uint64_t total_ns = 0, max_ns = 0, total_px = 0;
+    uint32_t max_px = 0;
+    int worst = 0;
+    for(int i = 0; i < num_states; i++) {
+      total_ns += s->best_ns[i];
+      total_px += s->pixels[i];
+      if(s->best_ns[i] > max_ns) { max_ns = s->best_ns[i]; worst = i; }
+      if(s->pixels[i] > max_px) max_px = s->pixels[i];
+    }
+    char worst_state[12];
+    snprintf(worst_state, sizeof(worst_state), "%02d:%02d", worst / 60, worst % 60);
+    if(csv) printf("%s,%s,%llu,%llu,%s,%llu,%u,%u\n", PBL_PLATFORM_NAME, s->name,
+                   (unsigned long long)(total_ns / num_states), (unsigned long long)max_ns, worst_state,
+                   (unsigned long long)(total_px / num_states), max_px, s->radial_fills / passes);
+    else printf("%-8s %-20s %10llu %10llu %6s %11llu %10u %8u\n", PBL_PLATFORM_NAME, s->name,
+                (unsigned long long)(total_ns / num_states), (unsigned long long)max_ns, worst_state,
+                (unsigned long long)(total_px / num_states), max_px, s->radial_fills / passes);
+  }
+}
+
+static void report_quick_view(int passes) {
+  //a Quick View peek and its return, 20 animation frames each way
+  uint32_t radial_before = stub_counters.fill_radial;
+  uint64_t start = now_ns();
+  for(int pass = 0; pass < passes; pass++) {
+    stub_unobstructed_animate(PBL_DISPLAY_HEIGHT - 51, 20);
+    stub_unobstructed_animate(PBL_DISPLAY_HEIGHT, 20);
+  }
+  uint64_t elapsed = now_ns() - start;
+  printf("%-8s %-20s %10llu ns/frame %8u radials/peek\n", PBL_PLATFORM_NAME, "quick view",
+         (unsigned long long)(elapsed / (passes * 40)), (stub_counters.fill_radial - radial_before) / passes);
+}
+
+static uint32_t count_differences(const uint8_t *a, const uint8_t *b, size_t size) {
+  uint32_t count = 0;
+  for(size_t i = 0; i < size; i++) count += (a[i] != b[i]);
+  return count;
+}
+
+static uint32_t compare_state(bool antialiased, uint8_t *reference, size_t size) {
+  //the face turns antialiasing off while saving power
+  bool saving = power_saving;
+  power_saving = !antialiased;
+  uint8_t *data = gbitmap_get_data(stub_framebuffer());
+  for(int spans = 0; spans < 2; spans++) {
+    bench_span_rings = spans;
+    invalidate_ring_cache();
+    stub_clear();
+    stub_draw_layer(ring_layer);
+    if(!spans) memcpy(reference, data, size);
+  }
+  power_saving = saving;
+  return count_differences(reference, data, size);
+}
+
+static void report_span_compare(void) {
+  /*
+  Draws the rings of every state with graphics_fill_radial and with the
+  span tables and counts the pixels that differ. Without antialiasing
+  only pixels on the angular ends of the rings should differ, where the
+  two round their angles differently; with it, both blend the circles'
+  edge pixels too, from coverage worked out in different ways
+  */
+  GBitmap *fb = stub_framebuffer();
+  if(gbitmap_get_format(fb) == GBitmapFormat1Bit) {
+    printf("%-8s span rings need an 8 bit framebuffer\n", PBL_PLATFORM_NAME);
+    return;
+  }
+  size_t size = gbitmap_get_bytes_per_row(fb) * gbitmap_get_bounds(fb).size.h;
+  uint8_t *reference = malloc(size);
+  uint32_t total[2] = { 0, 0 }, max[2] = { 0, 0 };
+  bool spans = bench_span_rings;
+  for(int state = 0; state < num_states; state++) {
+    tick_to(state);
+    for(int antialiased = 0; antialiased < 2; antialiased++) {
+      uint32_t differences = compare_state(antialiased, reference, size);
+      total[antialiased] += differences;
+      if(differences > max[antialiased]) max[antialiased] = differences;
+    }
+  }
+  bench_span_rings = spans;
+  invalidate_ring_cache();
+  free(reference);
+  printf("%-8s span rings vs fill_radial: aliased %u px differ (max %u per state), "
+         "antialiased %u px differ (max %u per state)\n", PBL_PLATFORM_NAME,
+         total[0], max[0], total[1], max[1]);
+}
+
+int main(int argc, char **argv) {
+  int passes = 3;
+  bool csv = false, compare = false;
+  int opt;
+  while((opt = getopt(argc, argv, "p:csd")) != -1) {
+    switch(opt) {
+      case 'p': passes = atoi(optarg); break;
+      case 'c': csv = true; break;
+      case 's': bench_span_rings = true; break;
+      case 'd': compare = true; break;
+      default:
+        fprintf(stderr, "usage: %s [-p passes] [-c] [-s] [-d]\n", argv[0]);
+        return 2;
+    }
+  }
+  if(passes < 1) passes = 1;
+
+  setenv("TZ", "UTC", 1);
+  tzset();
+  srand(1);
+  stub_set_time(bench_epoch);
+  stub_set_health(HealthMetricStepCount, 8421);
+  stub_set_health(HealthMetricWalkedDistanceMeters, 6120);
+  stub_set_health(HealthMetricActiveKCalories, 312);
+  stub_set_battery((BatteryChargeState){ .charge_percent = 70 });
+  init();
+
+  //the icon only draws while disconnected, which is the case worth timing
+  stub_set_connected(false);
+  bluetooth_callback(false);
+
+  if(compare) {
+    report_span_compare();
+    deinit();
+    return 0;
+  }
+
+  //procs and whole frames get separate sweeps so each sees a fresh minute
+  for(int pass = 0; pass < passes; pass++) {
+    for(int state = 0; state < num_states; state++) {
+      tick_to(state);
+      stub_clear();
+      measure(PROC_RING, state, ring_layer);
+      measure(PROC_BATTERY, state, battery_layer);
+      measure(PROC_BT_ICON, state, bt_icon_layer);
+      measure(PROC_LINE, state, line_one_layer);
+    }
+    for(int state = 0; state < num_states; state++) {
+      tick_to(state);
+      measure(PROC_FRAME, state, NULL);
+    }
+  }
+
+  report(csv, passes);
+  if(!csv) report_quick_view(passes);
+  deinit();
+  return 0;
+}
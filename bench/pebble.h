@@ -0,0 +1,598 @@
+#pragma once
+
+/*
+Host-side stand-in for the Pebble SDK header. It declares just enough of
+the SDK for src/c/main.c to compile on Linux, backed by a software
+GContext in pebble_stub.c. Select the platform with one of
+-DPBL_PLATFORM_APLITE/BASALT/CHALK/DIORITE, exactly like the real SDK
+does per target.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+The app heap is accounted the way the firmware does it, so
+heap_bytes_used and heap_bytes_free mean the same thing on the host.
+Layers and bitmaps the SDK creates for the app count against it
+*/
+void *stub_malloc(size_t size);
+void *stub_calloc(size_t count, size_t size);
+void *stub_realloc(void *ptr, size_t size);
+void stub_free(void *ptr);
+#define malloc stub_malloc
+#define calloc stub_calloc
+#define realloc stub_realloc
+#define free stub_free
+
+//platform capabilities
+#if defined(PBL_PLATFORM_APLITE)
+  #define PBL_BW
+  #define PBL_RECT
+  #define PBL_PLATFORM_NAME "aplite"
+  #define PBL_DISPLAY_WIDTH 144
+  #define PBL_DISPLAY_HEIGHT 168
+#elif defined(PBL_PLATFORM_BASALT)
+  #define PBL_COLOR
+  #define PBL_RECT
+  #define PBL_HEALTH
+  #define PBL_PLATFORM_NAME "basalt"
+  #define PBL_DISPLAY_WIDTH 144
+  #define PBL_DISPLAY_HEIGHT 168
+#elif defined(PBL_PLATFORM_CHALK)
+  #define PBL_COLOR
+  #define PBL_ROUND
+  #define PBL_HEALTH
+  #define PBL_PLATFORM_NAME "chalk"
+  #define PBL_DISPLAY_WIDTH 180
+  #define PBL_DISPLAY_HEIGHT 180
+#elif defined(PBL_PLATFORM_DIORITE)
+  #define PBL_BW
+  #define PBL_RECT
+  #define PBL_HEALTH
+  #define PBL_PLATFORM_NAME "diorite"
+  #define PBL_DISPLAY_WIDTH 144
+  #define PBL_DISPLAY_HEIGHT 168
+#else
+  #error "define one of PBL_PLATFORM_APLITE/BASALT/CHALK/DIORITE"
+#endif
+
+#if defined(PBL_ROUND)
+  #define PBL_IF_ROUND_ELSE(if_true, if_false) (if_true)
+  #define PBL_IF_RECT_ELSE(if_true, if_false) (if_false)
+#else
+  #define PBL_IF_ROUND_ELSE(if_true, if_false) (if_false)
+  #define PBL_IF_RECT_ELSE(if_true, if_false) (if_true)
+#endif
+#if defined(PBL_COLOR)
+  #define PBL_IF_COLOR_ELSE(if_true, if_false) (if_true)
+  #define PBL_IF_BW_ELSE(if_true, if_false) (if_false)
+#else
+  #define PBL_IF_COLOR_ELSE(if_true, if_false) (if_false)
+  #define PBL_IF_BW_ELSE(if_true, if_false) (if_true)
+#endif
+#if defined(PBL_HEALTH)
+  #define PBL_IF_HEALTH_ELSE(if_true, if_false) (if_true)
+#else
+  #define PBL_IF_HEALTH_ELSE(if_true, if_false) (if_false)
+#endif
+
+//message keys normally generated from package.json
+#define MESSAGE_KEY_colorSetting 10000
+#define MESSAGE_KEY_backgroundColor 10001
+#define MESSAGE_KEY_foregroundColor 10002
+#define MESSAGE_KEY_topLineSetting 10003
+#define MESSAGE_KEY_bottomLineSetting 10004
+#define MESSAGE_KEY_centerLineSetting 10005
+#define MESSAGE_KEY_bluetoothVibes 10006
+#define MESSAGE_KEY_bluetoothIcon 10007
+#define MESSAGE_KEY_powerSaveBattery 10008
+#define MESSAGE_KEY_quietHours 10009
+#define MESSAGE_KEY_quietStart 10010
+#define MESSAGE_KEY_quietEnd 10011
+#define MESSAGE_KEY_telemetry 10012
+#define MESSAGE_KEY_telemetryRequest 10013
+#define MESSAGE_KEY_telemetryData 10014
+#define MESSAGE_KEY_secondsRing 10015
+#define MESSAGE_KEY_revealLines 10016
+
+//logging
+typedef enum {
+  APP_LOG_LEVEL_ERROR = 1,
+  APP_LOG_LEVEL_WARNING = 50,
+  APP_LOG_LEVEL_INFO = 100,
+  APP_LOG_LEVEL_DEBUG = 200,
+  APP_LOG_LEVEL_DEBUG_VERBOSE = 255,
+} AppLogLevel;
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...)
+  __attribute__((format(printf, 4, 5)));
+#define APP_LOG(level, fmt, args...) app_log(level, __FILE__, __LINE__, fmt, ## args)
+
+//time
+typedef enum {
+  SECOND_UNIT = 1 << 0,
+  MINUTE_UNIT = 1 << 1,
+  HOUR_UNIT = 1 << 2,
+  DAY_UNIT = 1 << 3,
+  MONTH_UNIT = 1 << 4,
+  YEAR_UNIT = 1 << 5,
+} TimeUnits;
+
+#define SECONDS_PER_MINUTE 60
+#define SECONDS_PER_HOUR 3600
+#define SECONDS_PER_DAY 86400
+
+time_t stub_time(time_t *tloc);
+#define time(tloc) stub_time(tloc)
+uint16_t time_ms(time_t *t_utc, uint16_t *out_ms);
+bool clock_is_24h_style(void);
+
+typedef void (*TickHandler)(struct tm *tick_time, TimeUnits units_changed);
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler);
+void tick_timer_service_unsubscribe(void);
+
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void *data);
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data);
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms);
+void app_timer_cancel(AppTimer *timer_handle);
+
+//trigonometry
+#define TRIG_MAX_RATIO 0xffff
+#define TRIG_MAX_ANGLE 0x10000
+#define DEG_TO_TRIGANGLE(angle) (((angle) * TRIG_MAX_ANGLE) / 360)
+#define TRIGANGLE_TO_DEG(trig_angle) (((trig_angle) * 360) / TRIG_MAX_ANGLE)
+int32_t sin_lookup(int32_t angle);
+int32_t cos_lookup(int32_t angle);
+
+//geometry
+typedef struct GPoint {
+  int16_t x;
+  int16_t y;
+} GPoint;
+#define GPoint(x, y) ((GPoint){(x), (y)})
+#define GPointZero GPoint(0, 0)
+
+typedef struct GSize {
+  int16_t w;
+  int16_t h;
+} GSize;
+#define GSize(w, h) ((GSize){(w), (h)})
+
+typedef struct GRect {
+  GPoint origin;
+  GSize size;
+} GRect;
+#define GRect(x, y, w, h) ((GRect){{(x), (y)}, {(w), (h)}})
+#define GRectZero GRect(0, 0, 0, 0)
+
+typedef struct GEdgeInsets {
+  int16_t top;
+  int16_t right;
+  int16_t bottom;
+  int16_t left;
+} GEdgeInsets;
+#define GEdgeInsets1(t) ((GEdgeInsets){(t), (t), (t), (t)})
+#define GEdgeInsets2(t, r) ((GEdgeInsets){(t), (r), (t), (r)})
+#define GEdgeInsets4(t, r, b, l) ((GEdgeInsets){(t), (r), (b), (l)})
+#define GEdgeInsets_SELECT(_1, _2, _3, _4, NAME, ...) NAME
+#define GEdgeInsets(...) GEdgeInsets_SELECT(__VA_ARGS__, GEdgeInsets4, GEdgeInsets3_unsupported, GEdgeInsets2, GEdgeInsets1)(__VA_ARGS__)
+
+bool grect_equal(const GRect *rect_a, const GRect *rect_b);
+bool gsize_equal(const GSize *size_a, const GSize *size_b);
+bool gpoint_equal(const GPoint *point_a, const GPoint *point_b);
+GRect grect_inset(GRect rect, GEdgeInsets insets);
+bool grect_contains_point(const GRect *rect, const GPoint *point);
+
+typedef enum {
+  GOvalScaleModeFitCircle,
+  GOvalScaleModeFillCircle,
+} GOvalScaleMode;
+
+//colors
+typedef union GColor8 {
+  uint8_t argb;
+  struct {
+    uint8_t b:2;
+    uint8_t g:2;
+    uint8_t r:2;
+    uint8_t a:2;
+  };
+} GColor8;
+typedef GColor8 GColor;
+
+#define GColorClearARGB8 ((uint8_t)0b00000000)
+#define GColorBlackARGB8 ((uint8_t)0b11000000)
+#define GColorOxfordBlueARGB8 ((uint8_t)0b11000001)
+#define GColorBlueARGB8 ((uint8_t)0b11000011)
+#define GColorDarkGreenARGB8 ((uint8_t)0b11000100)
+#define GColorIslamicGreenARGB8 ((uint8_t)0b11001000)
+#define GColorGreenARGB8 ((uint8_t)0b11001100)
+#define GColorCyanARGB8 ((uint8_t)0b11001111)
+#define GColorBulgarianRoseARGB8 ((uint8_t)0b11010000)
+#define GColorArmyGreenARGB8 ((uint8_t)0b11010100)
+#define GColorDarkGrayARGB8 ((uint8_t)0b11010101)
+#define GColorPictonBlueARGB8 ((uint8_t)0b11011011)
+#define GColorScreaminGreenARGB8 ((uint8_t)0b11011101)
+#define GColorDarkCandyAppleRedARGB8 ((uint8_t)0b11100000)
+#define GColorPurpleARGB8 ((uint8_t)0b11100010)
+#define GColorLightGrayARGB8 ((uint8_t)0b11101010)
+#define GColorBabyBlueEyesARGB8 ((uint8_t)0b11101011)
+#define GColorRedARGB8 ((uint8_t)0b11110000)
+#define GColorFashionMagentaARGB8 ((uint8_t)0b11110010)
+#define GColorMagentaARGB8 ((uint8_t)0b11110011)
+#define GColorOrangeARGB8 ((uint8_t)0b11110100)
+#define GColorChromeYellowARGB8 ((uint8_t)0b11111000)
+#define GColorRajahARGB8 ((uint8_t)0b11111001)
+#define GColorYellowARGB8 ((uint8_t)0b11111100)
+#define GColorWhiteARGB8 ((uint8_t)0b11111111)
+
+#define GColorClear ((GColor8){.argb = GColorClearARGB8})
+#define GColorBlack ((GColor8){.argb = GColorBlackARGB8})
+#define GColorBlue ((GColor8){.argb = GColorBlueARGB8})
+#define GColorDarkGray ((GColor8){.argb = GColorDarkGrayARGB8})
+#define GColorLightGray ((GColor8){.argb = GColorLightGrayARGB8})
+#define GColorWhite ((GColor8){.argb = GColorWhiteARGB8})
+
+#define GColorFromRGB(red, green, blue) \
+  ((GColor8){.argb = (uint8_t)(0xc0 | (((red) / 85) << 4) | (((green) / 85) << 2) | ((blue) / 85))})
+#define GColorFromHEX(v) GColorFromRGB(((v) >> 16) & 0xff, ((v) >> 8) & 0xff, ((v) & 0xff))
+
+bool gcolor_equal(GColor8 x, GColor8 y);
+GColor8 gcolor_legible_over(GColor8 background_color);
+
+//bitmaps
+typedef enum GBitmapFormat {
+  GBitmapFormat1Bit = 0,
+  GBitmapFormat8Bit,
+  GBitmapFormat1BitPalette,
+  GBitmapFormat2BitPalette,
+  GBitmapFormat4BitPalette,
+  GBitmapFormat8BitCircular,
+} GBitmapFormat;
+
+typedef struct GBitmap GBitmap;
+
+typedef struct GBitmapDataRowInfo {
+  uint8_t *data;
+  int16_t min_x;
+  int16_t max_x;
+} GBitmapDataRowInfo;
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format);
+GBitmap *gbitmap_create_blank_with_palette(GSize size, GBitmapFormat format, GColor *palette, bool free_on_destroy);
+GColor *gbitmap_get_palette(const GBitmap *bitmap);
+void gbitmap_set_bounds(GBitmap *bitmap, GRect bounds);
+void gbitmap_destroy(GBitmap *bitmap);
+uint8_t *gbitmap_get_data(const GBitmap *bitmap);
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap);
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap);
+GRect gbitmap_get_bounds(const GBitmap *bitmap);
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap *bitmap, uint16_t y);
+
+//graphics
+typedef struct GContext GContext;
+
+typedef enum {
+  GCompOpAssign,
+  GCompOpAssignInverted,
+  GCompOpOr,
+  GCompOpAnd,
+  GCompOpClear,
+  GCompOpSet,
+} GCompOp;
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color);
+void graphics_context_set_stroke_color(GContext *ctx, GColor color);
+void graphics_context_set_text_color(GContext *ctx, GColor color);
+void graphics_context_set_stroke_width(GContext *ctx, uint8_t stroke_width);
+void graphics_context_set_antialiased(GContext *ctx, bool enable);
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode);
+
+void graphics_draw_pixel(GContext *ctx, GPoint point);
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1);
+typedef enum {
+  GCornerNone = 0,
+  GCornersAll = 15,
+} GCornerMask;
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, int corner_mask);
+void graphics_fill_circle(GContext *ctx, GPoint p, uint16_t radius);
+void graphics_fill_radial(GContext *ctx, GRect rect, GOvalScaleMode scale_mode, uint16_t inset_thickness,
+                          int32_t angle_start, int32_t angle_end);
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect);
+GBitmap *graphics_capture_frame_buffer(GContext *ctx);
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer);
+
+//fonts and text
+typedef struct FontInfo *GFont;
+#define FONT_KEY_GOTHIC_14_BOLD "RESOURCE_ID_GOTHIC_14_BOLD"
+#define FONT_KEY_GOTHIC_18_BOLD "RESOURCE_ID_GOTHIC_18_BOLD"
+GFont fonts_get_system_font(const char *font_key);
+
+typedef enum {
+  GTextAlignmentLeft,
+  GTextAlignmentCenter,
+  GTextAlignmentRight,
+} GTextAlignment;
+
+typedef enum {
+  GTextOverflowModeWordWrap,
+  GTextOverflowModeTrailingEllipsis,
+  GTextOverflowModeFill,
+} GTextOverflowMode;
+
+typedef struct GTextAttributes GTextAttributes;
+
+void graphics_draw_text(GContext *ctx, const char *text, GFont const font, const GRect box,
+                        const GTextOverflowMode overflow_mode, const GTextAlignment alignment,
+                        GTextAttributes *text_attributes);
+GSize graphics_text_layout_get_content_size(const char *text, GFont const font, const GRect box,
+                                            const GTextOverflowMode overflow_mode, const GTextAlignment alignment);
+
+//layers and windows
+typedef struct Layer Layer;
+typedef struct TextLayer TextLayer;
+typedef struct Window Window;
+typedef void (*LayerUpdateProc)(Layer *layer, GContext *ctx);
+
+Layer *layer_create(GRect frame);
+Layer *layer_create_with_data(GRect frame, size_t data_size);
+void layer_destroy(Layer *layer);
+void *layer_get_data(const Layer *layer);
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc);
+void layer_mark_dirty(Layer *layer);
+void layer_add_child(Layer *parent, Layer *child);
+void layer_remove_from_parent(Layer *child);
+GRect layer_get_frame(const Layer *layer);
+void layer_set_frame(Layer *layer, GRect frame);
+GRect layer_get_bounds(const Layer *layer);
+void layer_set_bounds(Layer *layer, GRect bounds);
+GRect layer_get_unobstructed_bounds(const Layer *layer);
+void layer_set_hidden(Layer *layer, bool hidden);
+bool layer_get_hidden(const Layer *layer);
+
+TextLayer *text_layer_create(GRect frame);
+void text_layer_destroy(TextLayer *text_layer);
+Layer *text_layer_get_layer(TextLayer *text_layer);
+void text_layer_set_text(TextLayer *text_layer, const char *text);
+const char *text_layer_get_text(TextLayer *text_layer);
+void text_layer_set_background_color(TextLayer *text_layer, GColor color);
+void text_layer_set_text_color(TextLayer *text_layer, GColor color);
+void text_layer_set_font(TextLayer *text_layer, GFont font);
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment);
+
+typedef void (*WindowHandler)(Window *window);
+typedef struct WindowHandlers {
+  WindowHandler load;
+  WindowHandler appear;
+  WindowHandler disappear;
+  WindowHandler unload;
+} WindowHandlers;
+
+Window *window_create(void);
+void window_destroy(Window *window);
+void window_set_window_handlers(Window *window, WindowHandlers handlers);
+void window_set_background_color(Window *window, GColor background_color);
+Layer *window_get_root_layer(const Window *window);
+void window_stack_push(Window *window, bool animated);
+
+//unobstructed area
+typedef int32_t AnimationProgress;
+#define ANIMATION_NORMALIZED_MAX 65535
+
+typedef void (*UnobstructedAreaWillChangeHandler)(GRect final_unobstructed_screen_area, void *context);
+typedef void (*UnobstructedAreaChangeHandler)(AnimationProgress progress, void *context);
+typedef void (*UnobstructedAreaDidChangeHandler)(void *context);
+typedef struct UnobstructedAreaHandlers {
+  UnobstructedAreaWillChangeHandler will_change;
+  UnobstructedAreaChangeHandler change;
+  UnobstructedAreaDidChangeHandler did_change;
+} UnobstructedAreaHandlers;
+
+void unobstructed_area_service_subscribe(UnobstructedAreaHandlers handlers, void *context);
+void unobstructed_area_service_unsubscribe(void);
+
+//battery and connection
+typedef struct {
+  uint8_t charge_percent;
+  bool is_charging;
+  bool is_plugged;
+} BatteryChargeState;
+
+typedef void (*BatteryStateHandler)(BatteryChargeState charge);
+void battery_state_service_subscribe(BatteryStateHandler handler);
+void battery_state_service_unsubscribe(void);
+BatteryChargeState battery_state_service_peek(void);
+
+typedef void (*ConnectionHandler)(bool connected);
+typedef struct ConnectionHandlers {
+  ConnectionHandler pebble_app_connection_handler;
+  ConnectionHandler pebblekit_connection_handler;
+} ConnectionHandlers;
+
+void connection_service_subscribe(ConnectionHandlers conn_handlers);
+void connection_service_unsubscribe(void);
+bool connection_service_peek_pebble_app_connection(void);
+
+void vibes_double_pulse(void);
+void vibes_short_pulse(void);
+
+//accelerometer
+typedef enum {
+  ACCEL_AXIS_X = 0,
+  ACCEL_AXIS_Y = 1,
+  ACCEL_AXIS_Z = 2,
+} AccelAxisType;
+
+typedef void (*AccelTapHandler)(AccelAxisType axis, int32_t direction);
+void accel_tap_service_subscribe(AccelTapHandler handler);
+void accel_tap_service_unsubscribe(void);
+
+//health
+typedef int32_t HealthValue;
+typedef enum {
+  HealthMetricStepCount,
+  HealthMetricActiveSeconds,
+  HealthMetricWalkedDistanceMeters,
+  HealthMetricSleepSeconds,
+  HealthMetricSleepRestfulSeconds,
+  HealthMetricRestingKCalories,
+  HealthMetricActiveKCalories,
+  HealthMetricHeartRateBPM,
+} HealthMetric;
+
+typedef enum {
+  HealthEventSignificantUpdate = 0,
+  HealthEventMovementUpdate,
+  HealthEventSleepUpdate,
+  HealthEventMetricAlert,
+  HealthEventHeartRateUpdate,
+} HealthEventType;
+
+typedef void (*HealthEventHandler)(HealthEventType event, void *context);
+
+typedef enum {
+  HealthActivityNone = 0,
+  HealthActivitySleep = 1 << 0,
+  HealthActivityRestfulSleep = 1 << 1,
+  HealthActivityWalk = 1 << 2,
+  HealthActivityRun = 1 << 3,
+  HealthActivityOpenWorkout = 1 << 4,
+} HealthActivity;
+typedef uint32_t HealthActivityMask;
+
+HealthValue health_service_sum_today(HealthMetric metric);
+bool health_service_events_subscribe(HealthEventHandler handler, void *context);
+bool health_service_events_unsubscribe(void);
+HealthActivityMask health_service_peek_current_activities(void);
+
+//persistent storage
+#define PERSIST_DATA_MAX_LENGTH 256
+
+bool persist_exists(const uint32_t key);
+int32_t persist_read_int(const uint32_t key);
+bool persist_read_bool(const uint32_t key);
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size);
+int persist_write_int(const uint32_t key, const int32_t value);
+int persist_write_bool(const uint32_t key, const bool value);
+int persist_write_data(const uint32_t key, const void *data, const size_t size);
+int persist_delete(const uint32_t key);
+
+//app message
+typedef enum {
+  TUPLE_BYTE_ARRAY = 0,
+  TUPLE_CSTRING = 1,
+  TUPLE_UINT = 2,
+  TUPLE_INT = 3,
+} TupleType;
+
+typedef union TupleValue {
+  uint8_t data[0];
+  char cstring[0];
+  uint8_t uint8;
+  uint16_t uint16;
+  uint32_t uint32;
+  int8_t int8;
+  int16_t int16;
+  int32_t int32;
+} TupleValue;
+
+typedef struct Tuple {
+  uint32_t key;
+  TupleType type:8;
+  uint16_t length;
+  TupleValue value[];
+} __attribute__((__packed__)) Tuple;
+
+typedef enum {
+  DICT_OK = 0,
+  DICT_NOT_ENOUGH_STORAGE = 1 << 1,
+} DictionaryResult;
+
+typedef struct DictionaryIterator DictionaryIterator;
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key);
+Tuple *dict_read_first(DictionaryIterator *iter);
+Tuple *dict_read_next(DictionaryIterator *iter);
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t * const data, const uint16_t size);
+DictionaryResult dict_write_cstring(DictionaryIterator *iter, const uint32_t key, const char * const cstring);
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value);
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...);
+
+typedef enum {
+  APP_MSG_OK = 0,
+  APP_MSG_BUSY = 1 << 10,
+} AppMessageResult;
+
+typedef void (*AppMessageInboxReceived)(DictionaryIterator *iterator, void *context);
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback);
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound);
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator);
+AppMessageResult app_message_outbox_send(void);
+
+//memory
+size_t heap_bytes_used(void);
+size_t heap_bytes_free(void);
+
+//event loop
+void app_event_loop(void);
+
+/*
+Host harness controls. None of these exist on the watch; they let the
+benchmark and simulator drive the face the way the firmware would.
+*/
+
+typedef struct StubCounters {
+  uint32_t layer_mark_dirty;
+  uint32_t frames;
+  uint32_t pixels;
+  uint32_t fill_radial;
+  uint32_t draw_line;
+  uint32_t fill_circle;
+  uint32_t text_set;
+  uint32_t health_queries;
+  uint32_t persist_reads;
+  uint32_t persist_writes;
+  uint32_t vibes;
+  uint32_t outbox_sends;
+} StubCounters;
+
+extern StubCounters stub_counters;
+
+void stub_set_time(time_t now);
+//moves the clock forward, firing due app timers in order and rendering after each
+void stub_advance_ms(uint32_t ms);
+void stub_accel_tap(void);
+bool stub_accel_tap_subscribed(void);
+void stub_set_battery(BatteryChargeState state);
+void stub_set_connected(bool connected);
+//set the state and deliver it to the face's handler, as the firmware does on a change
+void stub_battery_event(BatteryChargeState state);
+void stub_connection_event(bool connected);
+void stub_set_health(HealthMetric metric, HealthValue value);
+void stub_health_event(HealthEventType event);
+void stub_set_activities(HealthActivityMask activities);
+void stub_set_unobstructed_height(int16_t height);
+//runs a Quick View animation to the given height the way the firmware does, rendering every frame
+void stub_unobstructed_animate(int16_t final_height, int frames);
+GBitmap *stub_framebuffer(void);
+GContext *stub_context_for_layer(Layer *layer);
+void stub_draw_layer(Layer *layer);
+void stub_clear(void);
+void stub_render(void);
+//runs the timers already due, then renders if anything was marked dirty
+bool stub_flush(void);
+void stub_reset(void);
+TickHandler stub_tick_handler(void);
+
+//builds a message from the phone with the dict_write_* calls, then delivers it
+DictionaryIterator *stub_inbox_begin(void);
+void stub_inbox_deliver(void);
+//the last message the face sent to the phone, NULL before the first
+DictionaryIterator *stub_outbox(void);
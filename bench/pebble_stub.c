@@ -0,0 +1,1270 @@
+#include <math.h>
+#include <stdarg.h>
+#include "pebble.h"
+
+/*
+Software implementation of the parts of the Pebble SDK that main.c uses.
+Drawing goes into a framebuffer with the same pixel format as the target
+platform (1-bit rows on aplite/diorite, 8-bit on basalt, 8-bit circular
+rows on chalk) so that code poking the captured framebuffer behaves the
+same way it does on the watch. Every pixel the stub writes is counted.
+*/
+
+#define max_layer_children 16
+#define max_persist_entries 32
+#define max_dict_tuples 16
+#define max_dict_bytes 512
+#define max_app_timers 8
+
+//app RAM per platform; on the watch code and statics share it with the heap
+#if defined(PBL_PLATFORM_APLITE)
+  #define stub_heap_size (24 * 1024)
+#else
+  #define stub_heap_size (64 * 1024)
+#endif
+
+StubCounters stub_counters;
+
+struct GBitmap {
+  uint8_t *data;
+  uint16_t bytes_per_row;
+  GBitmapFormat format;
+  GRect bounds;
+  GColor *palette;
+  bool free_palette;
+};
+
+struct GContext {
+  GBitmap *fb;
+  GPoint offset;  //layer origin in screen coordinates
+  GRect clip;     //screen coordinates
+  GColor fill_color, stroke_color, text_color;
+  uint8_t stroke_width;
+  bool antialiased;
+  GCompOp comp_op;
+};
+
+struct FontInfo {
+  int16_t size;
+};
+
+struct Layer {
+  GRect frame;
+  GRect bounds;
+  LayerUpdateProc update_proc;
+  bool hidden;
+  Layer *parent;
+  Layer *children[max_layer_children];
+  uint8_t num_children;
+  TextLayer *text_layer;
+  Window *window;
+  void *data;
+};
+
+struct TextLayer {
+  Layer *layer;
+  const char *text;
+  GFont font;
+  GColor text_color, background_color;
+  GTextAlignment alignment;
+};
+
+struct Window {
+  Layer *root;
+  GColor background_color;
+  WindowHandlers handlers;
+  bool loaded;
+};
+
+struct DictionaryIterator {
+  Tuple *tuples[max_dict_tuples];
+  uint8_t count;
+  uint8_t cursor;                 //for dict_read_first/next
+  uint16_t used, capacity;        //bytes of storage taken, and allowed (the app message buffer size)
+  uint8_t storage[max_dict_bytes];
+};
+
+static time_t stub_now;
+static uint16_t stub_now_ms;
+static BatteryChargeState stub_battery = { .charge_percent = 100 };
+static bool stub_connected = true;
+static HealthValue stub_health[HealthMetricHeartRateBPM + 1];
+static HealthActivityMask stub_activities;
+static int16_t stub_unobstructed_height = PBL_DISPLAY_HEIGHT;
+
+static TickHandler tick_handler_cb;
+static BatteryStateHandler battery_handler_cb;
+static ConnectionHandlers connection_handlers;
+static UnobstructedAreaHandlers unobstructed_handlers;
+static HealthEventHandler health_handler_cb;
+static void *health_handler_context;
+static AppMessageInboxReceived inbox_received_cb;
+static AccelTapHandler accel_tap_cb;
+static Window *top_window;
+static DictionaryIterator stub_inbox_dict, stub_outbox_dict;
+static uint32_t stub_inbox_size = max_dict_bytes, stub_outbox_size;
+static bool stub_outbox_open, stub_outbox_sent;
+
+static GBitmap *screen;
+static GContext screen_ctx;
+static bool window_dirty;  //the firmware only renders after something was marked dirty
+
+static struct {
+  uint32_t key;
+  uint16_t length;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} persist_entries[max_persist_entries];
+static uint8_t num_persist_entries;
+
+//logging and time
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...) {
+  if(!getenv("STUB_LOG")) return;
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "[%s:%d] ", src_filename, src_line_number);
+  vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+time_t stub_time(time_t *tloc) {
+  if(tloc) *tloc = stub_now;
+  return stub_now;
+}
+
+uint16_t time_ms(time_t *t_utc, uint16_t *out_ms) {
+  if(t_utc) *t_utc = stub_now;
+  if(out_ms) *out_ms = stub_now_ms;
+  return stub_now_ms;
+}
+
+bool clock_is_24h_style(void) {
+  return true;
+}
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) {
+  tick_handler_cb = handler;
+}
+
+void tick_timer_service_unsubscribe(void) {
+  tick_handler_cb = NULL;
+}
+
+//trigonometry
+int32_t sin_lookup(int32_t angle) {
+  return (int32_t)lround(sin(angle * 2.0 * M_PI / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+int32_t cos_lookup(int32_t angle) {
+  return (int32_t)lround(cos(angle * 2.0 * M_PI / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+//geometry
+bool grect_equal(const GRect *rect_a, const GRect *rect_b) {
+  return !memcmp(rect_a, rect_b, sizeof(GRect));
+}
+
+bool gpoint_equal(const GPoint *point_a, const GPoint *point_b) {
+  return (point_a->x == point_b->x) && (point_a->y == point_b->y);
+}
+
+GRect grect_inset(GRect rect, GEdgeInsets insets) {
+  GRect r = GRect(rect.origin.x + insets.left, rect.origin.y + insets.top,
+                  rect.size.w - insets.left - insets.right, rect.size.h - insets.top - insets.bottom);
+  if((r.size.w < 0) || (r.size.h < 0)) return GRectZero;
+  return r;
+}
+
+bool grect_contains_point(const GRect *rect, const GPoint *point) {
+  return (point->x >= rect->origin.x) && (point->x < rect->origin.x + rect->size.w) &&
+         (point->y >= rect->origin.y) && (point->y < rect->origin.y + rect->size.h);
+}
+
+static GRect grect_intersect(GRect a, GRect b) {
+  int x0 = (a.origin.x > b.origin.x) ? a.origin.x : b.origin.x;
+  int y0 = (a.origin.y > b.origin.y) ? a.origin.y : b.origin.y;
+  int x1 = (a.origin.x + a.size.w < b.origin.x + b.size.w) ? a.origin.x + a.size.w : b.origin.x + b.size.w;
+  int y1 = (a.origin.y + a.size.h < b.origin.y + b.size.h) ? a.origin.y + a.size.h : b.origin.y + b.size.h;
+  if((x1 <= x0) || (y1 <= y0)) return GRectZero;
+  return GRect(x0, y0, x1 - x0, y1 - y0);
+}
+
+//colors
+bool gsize_equal(const GSize *size_a, const GSize *size_b) {
+  return (size_a->w == size_b->w) && (size_a->h == size_b->h);
+}
+
+bool gcolor_equal(GColor8 x, GColor8 y) {
+  return x.argb == y.argb;
+}
+
+GColor8 gcolor_legible_over(GColor8 background_color) {
+  //weighted luminance in 2-bit channel units, max 3 * 10
+  int luma = background_color.r * 3 + background_color.g * 6 + background_color.b;
+  return (luma > 15) ? GColorBlack : GColorWhite;
+}
+
+//bitmaps
+static int16_t circular_min_x(int16_t y) {
+  double dy = y - (PBL_DISPLAY_HEIGHT - 1) / 2.0;
+  double r = PBL_DISPLAY_WIDTH / 2.0;
+  double half = sqrt((r * r > dy * dy) ? (r * r - dy * dy) : 0);
+  int16_t min_x = (int16_t)lround(r - half);
+  return (min_x > r - 1) ? (int16_t)(r - 1) : min_x;
+}
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format) {
+  GBitmap *bitmap = calloc(1, sizeof(GBitmap));
+  bitmap->format = format;
+  bitmap->bounds = GRect(0, 0, size.w, size.h);
+  //1 bit rows are padded to words, palettized rows to bytes
+  if(format == GBitmapFormat1Bit) bitmap->bytes_per_row = ((size.w + 31) / 32) * 4;
+  else if(format == GBitmapFormat1BitPalette) bitmap->bytes_per_row = (size.w + 7) / 8;
+  else if(format == GBitmapFormat2BitPalette) bitmap->bytes_per_row = (size.w + 3) / 4;
+  else if(format == GBitmapFormat4BitPalette) bitmap->bytes_per_row = (size.w + 1) / 2;
+  else bitmap->bytes_per_row = size.w;
+  bitmap->data = calloc(bitmap->bytes_per_row * size.h, 1);
+  return bitmap;
+}
+
+GBitmap *gbitmap_create_blank_with_palette(GSize size, GBitmapFormat format, GColor *palette, bool free_on_destroy) {
+  GBitmap *bitmap = gbitmap_create_blank(size, format);
+  bitmap->palette = palette;
+  bitmap->free_palette = free_on_destroy;
+  return bitmap;
+}
+
+GColor *gbitmap_get_palette(const GBitmap *bitmap) {
+  return bitmap->palette;
+}
+
+void gbitmap_set_bounds(GBitmap *bitmap, GRect bounds) {
+  bitmap->bounds = bounds;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+  if(!bitmap) return;
+  if(bitmap->free_palette) free(bitmap->palette);
+  free(bitmap->data);
+  free(bitmap);
+}
+
+uint8_t *gbitmap_get_data(const GBitmap *bitmap) {
+  return bitmap->data;
+}
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap) {
+  return bitmap->bytes_per_row;
+}
+
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap) {
+  return bitmap->format;
+}
+
+GRect gbitmap_get_bounds(const GBitmap *bitmap) {
+  return bitmap->bounds;
+}
+
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap *bitmap, uint16_t y) {
+  GBitmapDataRowInfo info = {
+    .data = bitmap->data + y * bitmap->bytes_per_row,
+    .min_x = 0,
+    .max_x = bitmap->bounds.size.w - 1
+  };
+  if(bitmap->format == GBitmapFormat8BitCircular) {
+    info.min_x = circular_min_x(y);
+    info.max_x = bitmap->bounds.size.w - 1 - info.min_x;
+  }
+  return info;
+}
+
+static GColor bitmap_get_pixel(const GBitmap *bitmap, int x, int y) {
+  GBitmapDataRowInfo row = gbitmap_get_data_row_info(bitmap, y);
+  if(bitmap->format == GBitmapFormat1Bit) {
+    return (row.data[x / 8] & (1 << (x % 8))) ? GColorWhite : GColorBlack;
+  }
+  if(bitmap->format == GBitmapFormat1BitPalette) {
+    //palettized pixels are packed from the most significant bit
+    return bitmap->palette[(row.data[x / 8] >> (7 - x % 8)) & 1];
+  }
+  if((x < row.min_x) || (x > row.max_x)) return GColorBlack;
+  return (GColor8){ .argb = row.data[x] };
+}
+
+static void bitmap_set_pixel(GBitmap *bitmap, int x, int y, GColor color) {
+  GBitmapDataRowInfo row = gbitmap_get_data_row_info(bitmap, y);
+  if(bitmap->format == GBitmapFormat1Bit) {
+    //anything brighter than mid gray lights the pixel
+    bool white = (color.r + color.g + color.b) >= 5;
+    if(white) row.data[x / 8] |= (1 << (x % 8));
+    else row.data[x / 8] &= ~(1 << (x % 8));
+    return;
+  }
+  if((x < row.min_x) || (x > row.max_x)) return;
+  row.data[x] = color.argb;
+}
+
+static void heap_untrack(void *ptr);
+
+static GBitmap *screen_bitmap(void) {
+  if(!screen) {
+    screen = gbitmap_create_blank(GSize(PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT),
+                                  PBL_IF_BW_ELSE(GBitmapFormat1Bit,
+                                  PBL_IF_ROUND_ELSE(GBitmapFormat8BitCircular, GBitmapFormat8Bit)));
+    //the framebuffer belongs to the firmware, not the app heap
+    heap_untrack(screen->data);
+    heap_untrack(screen);
+  }
+  return screen;
+}
+
+//graphics
+static void put_pixel(GContext *ctx, int x, int y, GColor color) {
+  x += ctx->offset.x;
+  y += ctx->offset.y;
+  if((x < ctx->clip.origin.x) || (x >= ctx->clip.origin.x + ctx->clip.size.w) ||
+     (y < ctx->clip.origin.y) || (y >= ctx->clip.origin.y + ctx->clip.size.h)) return;
+  if(color.a == 0) return;
+  bitmap_set_pixel(ctx->fb, x, y, color);
+  stub_counters.pixels++;
+}
+
+static void blend_pixel(GContext *ctx, int x, int y, GColor color, double coverage) {
+  //mixes each 2 bit channel with the pixel below, the way the firmware antialiases edges
+  int sx = x + ctx->offset.x, sy = y + ctx->offset.y;
+  if((sx < ctx->clip.origin.x) || (sx >= ctx->clip.origin.x + ctx->clip.size.w) ||
+     (sy < ctx->clip.origin.y) || (sy >= ctx->clip.origin.y + ctx->clip.size.h)) return;
+  GColor below = bitmap_get_pixel(ctx->fb, sx, sy);
+  GColor mixed = color;
+  mixed.r = (uint8_t)lround(below.r + (color.r - below.r) * coverage);
+  mixed.g = (uint8_t)lround(below.g + (color.g - below.g) * coverage);
+  mixed.b = (uint8_t)lround(below.b + (color.b - below.b) * coverage);
+  put_pixel(ctx, x, y, mixed);
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+  ctx->fill_color = color;
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+  ctx->stroke_color = color;
+}
+
+void graphics_context_set_text_color(GContext *ctx, GColor color) {
+  ctx->text_color = color;
+}
+
+void graphics_context_set_stroke_width(GContext *ctx, uint8_t stroke_width) {
+  ctx->stroke_width = stroke_width ? stroke_width : 1;
+}
+
+void graphics_context_set_antialiased(GContext *ctx, bool enable) {
+  ctx->antialiased = enable;
+}
+
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {
+  ctx->comp_op = mode;
+}
+
+void graphics_draw_pixel(GContext *ctx, GPoint point) {
+  put_pixel(ctx, point.x, point.y, ctx->stroke_color);
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, int corner_mask) {
+  for(int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++) {
+    for(int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++) {
+      put_pixel(ctx, x, y, ctx->fill_color);
+    }
+  }
+}
+
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+  stub_counters.draw_line++;
+  int dx = abs(p1.x - p0.x), sx = (p0.x < p1.x) ? 1 : -1;
+  int dy = -abs(p1.y - p0.y), sy = (p0.y < p1.y) ? 1 : -1;
+  int err = dx + dy;
+  int x = p0.x, y = p0.y;
+  int lo = -(ctx->stroke_width - 1) / 2, hi = ctx->stroke_width / 2;
+  while(true) {
+    for(int oy = lo; oy <= hi; oy++) {
+      for(int ox = lo; ox <= hi; ox++) {
+        put_pixel(ctx, x + ox, y + oy, ctx->stroke_color);
+      }
+    }
+    if((x == p1.x) && (y == p1.y)) break;
+    int e2 = 2 * err;
+    if(e2 >= dy) { err += dy; x += sx; }
+    if(e2 <= dx) { err += dx; y += sy; }
+  }
+}
+
+void graphics_fill_circle(GContext *ctx, GPoint p, uint16_t radius) {
+  stub_counters.fill_circle++;
+  int r2 = radius * radius;
+  for(int dy = -radius; dy <= radius; dy++) {
+    for(int dx = -radius; dx <= radius; dx++) {
+      if(dx * dx + dy * dy <= r2) put_pixel(ctx, p.x + dx, p.y + dy, ctx->fill_color);
+    }
+  }
+}
+
+static void extend_box(double *box, double x, double y) {
+  if(x < box[0]) box[0] = x;
+  if(y < box[1]) box[1] = y;
+  if(x > box[2]) box[2] = x;
+  if(y > box[3]) box[3] = y;
+}
+
+void graphics_fill_radial(GContext *ctx, GRect rect, GOvalScaleMode scale_mode, uint16_t inset_thickness,
+                          int32_t angle_start, int32_t angle_end) {
+  stub_counters.fill_radial++;
+  if(angle_end <= angle_start) return;
+  bool full = (angle_end - angle_start) >= TRIG_MAX_ANGLE;
+
+  double diameter = (rect.size.w < rect.size.h) ? rect.size.w : rect.size.h;
+  double cx = rect.origin.x + (rect.size.w - 1) / 2.0;
+  double cy = rect.origin.y + (rect.size.h - 1) / 2.0;
+  double r_outer = diameter / 2.0;
+  double r_inner = r_outer - inset_thickness;
+  if(r_inner < 0) r_inner = 0;
+
+  //only scan the bounding box of the arc, like the firmware's span walker
+  double box[4] = { cx + r_outer, cy + r_outer, cx - r_outer, cy - r_outer };
+  if(full) {
+    extend_box(box, cx - r_outer, cy - r_outer);
+    extend_box(box, cx + r_outer, cy + r_outer);
+  }
+  else {
+    double a0 = angle_start * 2.0 * M_PI / TRIG_MAX_ANGLE;
+    double a1 = angle_end * 2.0 * M_PI / TRIG_MAX_ANGLE;
+    double radii[2] = { r_inner, r_outer };
+    for(int i = 0; i < 2; i++) {
+      extend_box(box, cx + radii[i] * sin(a0), cy - radii[i] * cos(a0));
+      extend_box(box, cx + radii[i] * sin(a1), cy - radii[i] * cos(a1));
+    }
+    for(int q = (int)ceil(a0 / (M_PI / 2)); q * (M_PI / 2) <= a1; q++) {
+      double a = q * (M_PI / 2);
+      extend_box(box, cx + r_outer * sin(a), cy - r_outer * cos(a));
+    }
+  }
+
+  //antialiased edges reach half a pixel past the circles and are blended over what is already there
+  bool blend = ctx->antialiased && (ctx->fb->format != GBitmapFormat1Bit);
+  double fringe = blend ? 0.5 : 0;
+  int32_t start = angle_start % TRIG_MAX_ANGLE;
+  int32_t span = angle_end - angle_start;
+  for(int y = (int)floor(box[1] - fringe); y <= (int)ceil(box[3] + fringe); y++) {
+    for(int x = (int)floor(box[0] - fringe); x <= (int)ceil(box[2] + fringe); x++) {
+      double dx = x - cx, dy = y - cy;
+      double d = sqrt(dx * dx + dy * dy);
+      if((d > r_outer + fringe) || (d < r_inner - fringe)) continue;
+      if(!full) {
+        double a = atan2(dx, -dy);
+        if(a < 0) a += 2 * M_PI;
+        int32_t trig = (int32_t)(a * TRIG_MAX_ANGLE / (2 * M_PI));
+        int32_t rel = (trig - start + TRIG_MAX_ANGLE) % TRIG_MAX_ANGLE;
+        if(rel > span) continue;
+      }
+      double coverage = 1;
+      if(blend) {
+        if(d > r_outer - fringe) coverage = r_outer + fringe - d;
+        if((r_inner > 0) && (d < r_inner + fringe)) coverage = fmin(coverage, d - (r_inner - fringe));
+      }
+      if(coverage <= 0) continue;
+      if(coverage >= 1) put_pixel(ctx, x, y, ctx->fill_color);
+      else blend_pixel(ctx, x, y, ctx->fill_color, coverage);
+    }
+  }
+}
+
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {
+  GRect src = bitmap->bounds;
+  if((src.size.w <= 0) || (src.size.h <= 0)) return;
+
+  //8 bit sources on 8 bit screens go a row at a time, like the firmware's blitter
+  if((bitmap->format == GBitmapFormat8Bit) && (ctx->fb->format != GBitmapFormat1Bit) &&
+     ((ctx->comp_op == GCompOpAssign) || (ctx->comp_op == GCompOpSet))) {
+    GRect clip = ctx->clip;
+    int left = rect.origin.x + ctx->offset.x, top = rect.origin.y + ctx->offset.y;
+    for(int y = 0; y < rect.size.h; y++) {
+      int screen_y = top + y;
+      if((screen_y < clip.origin.y) || (screen_y >= clip.origin.y + clip.size.h)) continue;
+      GBitmapDataRowInfo row = gbitmap_get_data_row_info(ctx->fb, screen_y);
+      const uint8_t *source = bitmap->data + (src.origin.y + y % src.size.h) * bitmap->bytes_per_row + src.origin.x;
+      int lo = left, hi = left + rect.size.w - 1;
+      if(lo < clip.origin.x) lo = clip.origin.x;
+      if(lo < row.min_x) lo = row.min_x;
+      if(hi > clip.origin.x + clip.size.w - 1) hi = clip.origin.x + clip.size.w - 1;
+      if(hi > row.max_x) hi = row.max_x;
+      for(int screen_x = lo; screen_x <= hi; screen_x++) {
+        uint8_t pixel = source[(screen_x - left) % src.size.w];
+        if(!(pixel >> 6)) continue;  //transparent
+        row.data[screen_x] = pixel;
+        stub_counters.pixels++;
+      }
+    }
+    return;
+  }
+
+  for(int y = 0; y < rect.size.h; y++) {
+    for(int x = 0; x < rect.size.w; x++) {
+      GColor color = bitmap_get_pixel(bitmap, src.origin.x + x % src.size.w, src.origin.y + y % src.size.h);
+      if(bitmap->format == GBitmapFormat1Bit) {
+        //1 bit sources act as masks for everything but assignment
+        bool white = gcolor_equal(color, GColorWhite);
+        switch(ctx->comp_op) {
+          case GCompOpAssignInverted: color = white ? GColorBlack : GColorWhite; break;
+          case GCompOpSet: case GCompOpOr: if(!white) continue; break;
+          case GCompOpClear: if(!white) continue; color = GColorBlack; break;
+          case GCompOpAnd: if(white) continue; break;
+          default: break;
+        }
+      }
+      put_pixel(ctx, rect.origin.x + x, rect.origin.y + y, color);
+    }
+  }
+}
+
+GBitmap *graphics_capture_frame_buffer(GContext *ctx) {
+  return ctx->fb;
+}
+
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer) {
+  return buffer == ctx->fb;
+}
+
+//fonts and text
+static struct FontInfo gothic_14 = { 14 }, gothic_18 = { 18 };
+
+GFont fonts_get_system_font(const char *font_key) {
+  return strstr(font_key, "14") ? &gothic_14 : &gothic_18;
+}
+
+static int16_t glyph_width(GFont font) {
+  return font->size / 2;
+}
+
+GSize graphics_text_layout_get_content_size(const char *text, GFont const font, const GRect box,
+                                            const GTextOverflowMode overflow_mode, const GTextAlignment alignment) {
+  int16_t w = strlen(text) * glyph_width(font);
+  return GSize((w < box.size.w) ? w : box.size.w, font->size);
+}
+
+void graphics_draw_text(GContext *ctx, const char *text, GFont const font, const GRect box,
+                        const GTextOverflowMode overflow_mode, const GTextAlignment alignment,
+                        GTextAttributes *text_attributes) {
+  //glyphs are stand-in patterns with a realistic ink density, not real letterforms
+  GSize content = graphics_text_layout_get_content_size(text, font, box, overflow_mode, alignment);
+  int16_t x0 = box.origin.x;
+  if(alignment == GTextAlignmentCenter) x0 += (box.size.w - content.w) / 2;
+  else if(alignment == GTextAlignmentRight) x0 += box.size.w - content.w;
+  int16_t gw = glyph_width(font), top = font->size / 4, gh = font->size - top;
+  for(size_t i = 0; text[i]; i++) {
+    unsigned char ch = text[i];
+    if(ch == ' ') continue;
+    for(int y = 0; y < gh; y++) {
+      for(int x = 0; x < gw - 1; x++) {
+        if(((x * 7 + y * 13 + ch) % 3) == 0)
+          put_pixel(ctx, x0 + i * gw + x, box.origin.y + top + y, ctx->text_color);
+      }
+    }
+  }
+}
+
+//layers
+Layer *layer_create(GRect frame) {
+  Layer *layer = calloc(1, sizeof(Layer));
+  layer->frame = frame;
+  layer->bounds = GRect(0, 0, frame.size.w, frame.size.h);
+  return layer;
+}
+
+Layer *layer_create_with_data(GRect frame, size_t data_size) {
+  Layer *layer = layer_create(frame);
+  layer->data = calloc(1, data_size);
+  return layer;
+}
+
+void layer_destroy(Layer *layer) {
+  if(!layer) return;
+  layer_remove_from_parent(layer);
+  free(layer->data);
+  free(layer);
+}
+
+void *layer_get_data(const Layer *layer) {
+  return layer->data;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+  layer->update_proc = update_proc;
+}
+
+void layer_mark_dirty(Layer *layer) {
+  stub_counters.layer_mark_dirty++;
+  window_dirty = true;
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+  if(parent->num_children < max_layer_children) {
+    parent->children[parent->num_children++] = child;
+    child->parent = parent;
+  }
+}
+
+void layer_remove_from_parent(Layer *child) {
+  Layer *parent = child->parent;
+  if(!parent) return;
+  for(int i = 0; i < parent->num_children; i++) {
+    if(parent->children[i] == child) {
+      memmove(&parent->children[i], &parent->children[i + 1], (parent->num_children - i - 1) * sizeof(Layer *));
+      parent->num_children--;
+      break;
+    }
+  }
+  child->parent = NULL;
+}
+
+GRect layer_get_frame(const Layer *layer) {
+  return layer->frame;
+}
+
+void layer_set_frame(Layer *layer, GRect frame) {
+  if(!grect_equal(&layer->frame, &frame)) window_dirty = true;
+  layer->frame = frame;
+  layer->bounds.size = frame.size;
+}
+
+GRect layer_get_bounds(const Layer *layer) {
+  return layer->bounds;
+}
+
+void layer_set_bounds(Layer *layer, GRect bounds) {
+  layer->bounds = bounds;
+}
+
+static GPoint layer_screen_origin(const Layer *layer) {
+  GPoint origin = GPointZero;
+  for(const Layer *l = layer; l; l = l->parent) {
+    origin.x += l->frame.origin.x + (l->parent ? l->parent->bounds.origin.x : 0);
+    origin.y += l->frame.origin.y + (l->parent ? l->parent->bounds.origin.y : 0);
+  }
+  return origin;
+}
+
+GRect layer_get_unobstructed_bounds(const Layer *layer) {
+  GPoint origin = layer_screen_origin(layer);
+  GRect area = GRect(-origin.x, -origin.y, PBL_DISPLAY_WIDTH, stub_unobstructed_height);
+  return grect_intersect(layer->bounds, area);
+}
+
+void layer_set_hidden(Layer *layer, bool hidden) {
+  if(layer->hidden != hidden) window_dirty = true;
+  layer->hidden = hidden;
+}
+
+bool layer_get_hidden(const Layer *layer) {
+  return layer->hidden;
+}
+
+static void text_layer_update_proc(Layer *layer, GContext *ctx) {
+  TextLayer *text_layer = layer->text_layer;
+  if(text_layer->background_color.a) {
+    graphics_context_set_fill_color(ctx, text_layer->background_color);
+    graphics_fill_rect(ctx, layer->bounds, 0, 0);
+  }
+  if(!text_layer->text) return;
+  graphics_context_set_text_color(ctx, text_layer->text_color);
+  graphics_draw_text(ctx, text_layer->text, text_layer->font, layer->bounds,
+                     GTextOverflowModeWordWrap, text_layer->alignment, NULL);
+}
+
+TextLayer *text_layer_create(GRect frame) {
+  TextLayer *text_layer = calloc(1, sizeof(TextLayer));
+  text_layer->layer = layer_create(frame);
+  text_layer->layer->text_layer = text_layer;
+  text_layer->layer->update_proc = text_layer_update_proc;
+  text_layer->font = &gothic_14;
+  text_layer->text_color = GColorBlack;
+  text_layer->background_color = GColorWhite;
+  return text_layer;
+}
+
+void text_layer_destroy(TextLayer *text_layer) {
+  if(!text_layer) return;
+  layer_destroy(text_layer->layer);
+  free(text_layer);
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer) {
+  return text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text) {
+  stub_counters.text_set++;
+  text_layer->text = text;
+  window_dirty = true;
+}
+
+const char *text_layer_get_text(TextLayer *text_layer) {
+  return text_layer->text;
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color) {
+  text_layer->background_color = color;
+}
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color) {
+  if(!gcolor_equal(text_layer->text_color, color)) window_dirty = true;
+  text_layer->text_color = color;
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font) {
+  if(text_layer->font != font) window_dirty = true;
+  text_layer->font = font;
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment) {
+  text_layer->alignment = text_alignment;
+}
+
+//windows
+Window *window_create(void) {
+  Window *window = calloc(1, sizeof(Window));
+  window->root = layer_create(GRect(0, 0, PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT));
+  window->root->window = window;
+  window->background_color = GColorWhite;
+  return window;
+}
+
+void window_destroy(Window *window) {
+  if(!window) return;
+  if(window->loaded && window->handlers.unload) window->handlers.unload(window);
+  if(top_window == window) top_window = NULL;
+  layer_destroy(window->root);
+  free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+  window->handlers = handlers;
+}
+
+void window_set_background_color(Window *window, GColor background_color) {
+  if(!gcolor_equal(window->background_color, background_color)) window_dirty = true;
+  window->background_color = background_color;
+}
+
+Layer *window_get_root_layer(const Window *window) {
+  return window->root;
+}
+
+void window_stack_push(Window *window, bool animated) {
+  top_window = window;
+  window_dirty = true;
+  if(!window->loaded && window->handlers.load) {
+    window->loaded = true;
+    window->handlers.load(window);
+  }
+}
+
+//services
+void unobstructed_area_service_subscribe(UnobstructedAreaHandlers handlers, void *context) {
+  unobstructed_handlers = handlers;
+}
+
+void unobstructed_area_service_unsubscribe(void) {
+  memset(&unobstructed_handlers, 0, sizeof(unobstructed_handlers));
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+  battery_handler_cb = handler;
+}
+
+void battery_state_service_unsubscribe(void) {
+  battery_handler_cb = NULL;
+}
+
+BatteryChargeState battery_state_service_peek(void) {
+  return stub_battery;
+}
+
+void connection_service_subscribe(ConnectionHandlers conn_handlers) {
+  connection_handlers = conn_handlers;
+}
+
+void connection_service_unsubscribe(void) {
+  memset(&connection_handlers, 0, sizeof(connection_handlers));
+}
+
+bool connection_service_peek_pebble_app_connection(void) {
+  return stub_connected;
+}
+
+void vibes_double_pulse(void) {
+  stub_counters.vibes++;
+}
+
+void vibes_short_pulse(void) {
+  stub_counters.vibes++;
+}
+
+HealthValue health_service_sum_today(HealthMetric metric) {
+  stub_counters.health_queries++;
+  return stub_health[metric];
+}
+
+bool health_service_events_subscribe(HealthEventHandler handler, void *context) {
+#if defined(PBL_HEALTH)
+  health_handler_cb = handler;
+  health_handler_context = context;
+  return true;
+#else
+  return false;
+#endif
+}
+
+HealthActivityMask health_service_peek_current_activities(void) {
+  return stub_activities;
+}
+
+bool health_service_events_unsubscribe(void) {
+  health_handler_cb = NULL;
+  return true;
+}
+
+void accel_tap_service_subscribe(AccelTapHandler handler) {
+  accel_tap_cb = handler;
+}
+
+void accel_tap_service_unsubscribe(void) {
+  accel_tap_cb = NULL;
+}
+
+//timers
+struct AppTimer {
+  bool scheduled;
+  uint64_t due_ms;
+  AppTimerCallback callback;
+  void *data;
+};
+
+static AppTimer app_timers[max_app_timers];
+
+static uint64_t stub_clock_ms(void) {
+  return (uint64_t)stub_now * 1000 + stub_now_ms;
+}
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data) {
+  for(int i = 0; i < max_app_timers; i++) {
+    if(app_timers[i].scheduled) continue;
+    app_timers[i] = (AppTimer){ true, stub_clock_ms() + timeout_ms, callback, callback_data };
+    return &app_timers[i];
+  }
+  return NULL;
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms) {
+  if(!timer_handle || !timer_handle->scheduled) return false;
+  timer_handle->due_ms = stub_clock_ms() + new_timeout_ms;
+  return true;
+}
+
+void app_timer_cancel(AppTimer *timer_handle) {
+  if(timer_handle) timer_handle->scheduled = false;
+}
+
+static AppTimer *next_timer(uint64_t due_by) {
+  //the earliest timer due by then, NULL if none
+  AppTimer *next = NULL;
+  for(int i = 0; i < max_app_timers; i++) {
+    if(app_timers[i].scheduled && (app_timers[i].due_ms <= due_by) &&
+       (!next || (app_timers[i].due_ms < next->due_ms)))
+      next = &app_timers[i];
+  }
+  return next;
+}
+
+static void run_due_timers(void) {
+  //timers already due, such as those registered with no delay, run before the event loop renders
+  AppTimer *next;
+  while((next = next_timer(stub_clock_ms()))) {
+    next->scheduled = false;
+    next->callback(next->data);
+  }
+}
+
+//persistent storage
+static int persist_find(uint32_t key) {
+  for(int i = 0; i < num_persist_entries; i++) {
+    if(persist_entries[i].key == key) return i;
+  }
+  return -1;
+}
+
+bool persist_exists(const uint32_t key) {
+  stub_counters.persist_reads++;
+  return persist_find(key) >= 0;
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size) {
+  stub_counters.persist_reads++;
+  int i = persist_find(key);
+  if(i < 0) return -1;
+  size_t n = (persist_entries[i].length < buffer_size) ? persist_entries[i].length : buffer_size;
+  memcpy(buffer, persist_entries[i].data, n);
+  return n;
+}
+
+int32_t persist_read_int(const uint32_t key) {
+  int32_t value = 0;
+  persist_read_data(key, &value, sizeof(value));
+  return value;
+}
+
+bool persist_read_bool(const uint32_t key) {
+  bool value = false;
+  persist_read_data(key, &value, sizeof(value));
+  return value;
+}
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size) {
+  stub_counters.persist_writes++;
+  int i = persist_find(key);
+  if(i < 0) {
+    if(num_persist_entries == max_persist_entries) return -1;
+    i = num_persist_entries++;
+    persist_entries[i].key = key;
+  }
+  size_t n = (size < PERSIST_DATA_MAX_LENGTH) ? size : PERSIST_DATA_MAX_LENGTH;
+  memcpy(persist_entries[i].data, data, n);
+  persist_entries[i].length = n;
+  return n;
+}
+
+int persist_write_int(const uint32_t key, const int32_t value) {
+  return persist_write_data(key, &value, sizeof(value));
+}
+
+int persist_write_bool(const uint32_t key, const bool value) {
+  return persist_write_data(key, &value, sizeof(value));
+}
+
+int persist_delete(const uint32_t key) {
+  int i = persist_find(key);
+  if(i < 0) return -1;
+  persist_entries[i] = persist_entries[--num_persist_entries];
+  return 0;
+}
+
+//app message
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
+  for(int i = 0; i < iter->count; i++) {
+    if(iter->tuples[i]->key == key) return iter->tuples[i];
+  }
+  return NULL;
+}
+
+Tuple *dict_read_first(DictionaryIterator *iter) {
+  iter->cursor = 0;
+  return dict_read_next(iter);
+}
+
+Tuple *dict_read_next(DictionaryIterator *iter) {
+  if(iter->cursor >= iter->count) return NULL;
+  return iter->tuples[iter->cursor++];
+}
+
+static DictionaryResult dict_write(DictionaryIterator *iter, uint32_t key, TupleType type,
+                                   const void *data, uint16_t size) {
+  uint16_t needed = sizeof(Tuple) + size;
+  if((iter->count == max_dict_tuples) || (iter->used + needed > iter->capacity))
+    return DICT_NOT_ENOUGH_STORAGE;
+  Tuple *tuple = (Tuple *)(iter->storage + iter->used);
+  tuple->key = key;
+  tuple->type = type;
+  tuple->length = size;
+  memcpy(tuple->value, data, size);
+  iter->tuples[iter->count++] = tuple;
+  iter->used += needed;
+  return DICT_OK;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t * const data, const uint16_t size) {
+  return dict_write(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+DictionaryResult dict_write_cstring(DictionaryIterator *iter, const uint32_t key, const char * const cstring) {
+  return dict_write(iter, key, TUPLE_CSTRING, cstring, strlen(cstring) + 1);
+}
+
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value) {
+  return dict_write(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...) {
+  va_list sizes;
+  va_start(sizes, tuple_count);
+  uint32_t total = 1;  //tuple count
+  for(int i = 0; i < tuple_count; i++) total += sizeof(Tuple) + va_arg(sizes, uint32_t);
+  va_end(sizes);
+  return total;
+}
+
+static void dict_reset(DictionaryIterator *iter, uint32_t buffer_size) {
+  memset(iter, 0, sizeof(*iter));
+  iter->capacity = (buffer_size > 1) ? buffer_size - 1 : 0;
+  if(iter->capacity > max_dict_bytes) iter->capacity = max_dict_bytes;
+}
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback) {
+  AppMessageInboxReceived previous = inbox_received_cb;
+  inbox_received_cb = received_callback;
+  return previous;
+}
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+  stub_inbox_size = size_inbound;
+  stub_outbox_size = size_outbound;
+  return APP_MSG_OK;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+  if(stub_outbox_open) return APP_MSG_BUSY;
+  dict_reset(&stub_outbox_dict, stub_outbox_size);
+  stub_outbox_open = true;
+  stub_outbox_sent = false;
+  *iterator = &stub_outbox_dict;
+  return APP_MSG_OK;
+}
+
+AppMessageResult app_message_outbox_send(void) {
+  //the phone acknowledges at once, so the outbox is free again straight away
+  stub_outbox_open = false;
+  stub_outbox_sent = true;
+  stub_counters.outbox_sends++;
+  return APP_MSG_OK;
+}
+
+void app_event_loop(void) {
+}
+
+//harness controls
+void stub_set_time(time_t now) {
+  stub_now = now;
+  stub_now_ms = 0;
+}
+
+static void stub_set_clock_ms(uint64_t ms) {
+  stub_now = ms / 1000;
+  stub_now_ms = ms % 1000;
+}
+
+void stub_advance_ms(uint32_t ms) {
+  uint64_t target = stub_clock_ms() + ms;
+  AppTimer *next;
+  while((next = next_timer(target))) {
+    if(next->due_ms > stub_clock_ms()) stub_set_clock_ms(next->due_ms);
+    next->scheduled = false;
+    next->callback(next->data);
+    stub_flush();
+  }
+  stub_set_clock_ms(target);
+}
+
+void stub_accel_tap(void) {
+  if(accel_tap_cb) accel_tap_cb(ACCEL_AXIS_Z, 1);
+}
+
+bool stub_accel_tap_subscribed(void) {
+  return accel_tap_cb != NULL;
+}
+
+void stub_set_battery(BatteryChargeState state) {
+  stub_battery = state;
+}
+
+void stub_set_connected(bool connected) {
+  stub_connected = connected;
+}
+
+void stub_battery_event(BatteryChargeState state) {
+  stub_battery = state;
+  if(battery_handler_cb) battery_handler_cb(state);
+}
+
+void stub_connection_event(bool connected) {
+  stub_connected = connected;
+  if(connection_handlers.pebble_app_connection_handler)
+    connection_handlers.pebble_app_connection_handler(connected);
+}
+
+void stub_set_health(HealthMetric metric, HealthValue value) {
+  stub_health[metric] = value;
+}
+
+void stub_health_event(HealthEventType event) {
+  if(health_handler_cb) health_handler_cb(event, health_handler_context);
+}
+
+void stub_set_activities(HealthActivityMask activities) {
+  stub_activities = activities;
+}
+
+void stub_set_unobstructed_height(int16_t height) {
+  stub_unobstructed_height = height;
+}
+
+void stub_unobstructed_animate(int16_t final_height, int frames) {
+  int16_t start_height = stub_unobstructed_height;
+  if(unobstructed_handlers.will_change)
+    unobstructed_handlers.will_change(GRect(0, 0, PBL_DISPLAY_WIDTH, final_height), NULL);
+  for(int frame = 1; frame <= frames; frame++) {
+    stub_unobstructed_height = start_height + (final_height - start_height) * frame / frames;
+    if(unobstructed_handlers.change)
+      unobstructed_handlers.change((AnimationProgress)ANIMATION_NORMALIZED_MAX * frame / frames, NULL);
+    //the firmware lays out and redraws the window on every frame of the animation
+    window_dirty = true;
+    stub_flush();
+  }
+  if(unobstructed_handlers.did_change) unobstructed_handlers.did_change(NULL);
+  stub_flush();
+}
+
+GBitmap *stub_framebuffer(void) {
+  return screen_bitmap();
+}
+
+static void context_for_layer(GContext *ctx, Layer *layer, GRect parent_clip) {
+  GPoint origin = layer_screen_origin(layer);
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->fb = screen_bitmap();
+  ctx->offset = GPoint(origin.x + layer->bounds.origin.x, origin.y + layer->bounds.origin.y);
+  ctx->clip = grect_intersect(parent_clip, GRect(origin.x, origin.y, layer->frame.size.w, layer->frame.size.h));
+  ctx->fill_color = GColorBlack;
+  ctx->stroke_color = GColorBlack;
+  ctx->text_color = GColorBlack;
+  ctx->stroke_width = 1;
+  ctx->comp_op = GCompOpAssign;
+}
+
+GContext *stub_context_for_layer(Layer *layer) {
+  context_for_layer(&screen_ctx, layer, GRect(0, 0, PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT));
+  return &screen_ctx;
+}
+
+void stub_draw_layer(Layer *layer) {
+  if(layer->update_proc) layer->update_proc(layer, stub_context_for_layer(layer));
+}
+
+static void render_layer(Layer *layer, GRect parent_clip) {
+  if(layer->hidden) return;
+  context_for_layer(&screen_ctx, layer, parent_clip);
+  GRect clip = screen_ctx.clip;
+  if(layer->update_proc) layer->update_proc(layer, &screen_ctx);
+  for(int i = 0; i < layer->num_children; i++) {
+    render_layer(layer->children[i], clip);
+  }
+}
+
+void stub_clear(void) {
+  if(!top_window) return;
+  GContext *ctx = stub_context_for_layer(top_window->root);
+  graphics_context_set_fill_color(ctx, top_window->background_color);
+  graphics_fill_rect(ctx, top_window->root->bounds, 0, 0);
+}
+
+void stub_render(void) {
+  if(!top_window) return;
+  window_dirty = false;
+  stub_counters.frames++;
+  stub_clear();
+  render_layer(top_window->root, GRect(0, 0, PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT));
+}
+
+bool stub_flush(void) {
+  run_due_timers();
+  if(!window_dirty) return false;
+  stub_render();
+  return true;
+}
+
+void stub_reset(void) {
+  memset(&stub_counters, 0, sizeof(stub_counters));
+}
+
+TickHandler stub_tick_handler(void) {
+  return tick_handler_cb;
+}
+
+DictionaryIterator *stub_inbox_begin(void) {
+  //messages larger than the inbox the face opened would be dropped by the firmware
+  dict_reset(&stub_inbox_dict, stub_inbox_size);
+  return &stub_inbox_dict;
+}
+
+void stub_inbox_deliver(void) {
+  if(inbox_received_cb) inbox_received_cb(&stub_inbox_dict, NULL);
+}
+
+DictionaryIterator *stub_outbox(void) {
+  return stub_outbox_sent ? &stub_outbox_dict : NULL;
+}
+
+//memory, last so that everything above goes through the accounting
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+//every block is preceded by its size, padded to keep the block aligned
+#define heap_header_size sizeof(max_align_t)
+
+static size_t stub_heap_used;
+
+static size_t *heap_block_size(void *ptr) {
+  return (size_t *)((uint8_t *)ptr - heap_header_size);
+}
+
+void *stub_malloc(size_t size) {
+  if(stub_heap_used + size > stub_heap_size) return NULL;
+  uint8_t *block = malloc(heap_header_size + size);
+  if(!block) return NULL;
+  *(size_t *)block = size;
+  stub_heap_used += size;
+  return block + heap_header_size;
+}
+
+void *stub_calloc(size_t count, size_t size) {
+  void *ptr = stub_malloc(count * size);
+  if(ptr) memset(ptr, 0, count * size);
+  return ptr;
+}
+
+void *stub_realloc(void *ptr, size_t size) {
+  if(!ptr) return stub_malloc(size);
+  void *moved = stub_malloc(size);
+  if(!moved) return NULL;
+  size_t old_size = *heap_block_size(ptr);
+  memcpy(moved, ptr, (old_size < size) ? old_size : size);
+  stub_free(ptr);
+  return moved;
+}
+
+void stub_free(void *ptr) {
+  if(!ptr) return;
+  stub_heap_used -= *heap_block_size(ptr);
+  free(heap_block_size(ptr));
+}
+
+static void heap_untrack(void *ptr) {
+  stub_heap_used -= *heap_block_size(ptr);
+  *heap_block_size(ptr) = 0;
+}
+
+size_t heap_bytes_used(void) {
+  return stub_heap_used;
+}
+
+size_t heap_bytes_free(void) {
+  return stub_heap_size - stub_heap_used;
+}
@@ -0,0 +1,407 @@
+/*
+Replay simulator for the rings face. Like the benchmark, main.c is compiled
+in directly, but instead of timing draws it replays scripted timelines (days
+of minute ticks with battery drain and charging, bluetooth flapping, Quick
+View peeks, configuration messages, relaunches and flicks of the wrist)
+through the face's own handlers, and counts the calls that cost battery on
+a watch: layers marked dirty, frames and pixels drawn, radial fills, health
+queries, persistent storage writes, vibrations and AppMessages sent.
+
+Each scenario runs in its own process, so every one starts from a freshly
+loaded face. The counters are deterministic. budgets.txt holds the checked-in
+figures; any counter above its budget fails the run:
+
+    make -C bench replay     run every scenario against budgets.txt
+    make -C bench budgets    rewrite budgets.txt from the current tree
+
+Span ring fills and sprite swaps write the framebuffer directly, so they do
+not show in the pixel counts.
+
+Built with heap_accounting (make -C bench heap), it prints the face's heap
+and stack accounting for each scenario instead. The window is loaded a second
+time after the scenario, so anything left behind by an unload shows up.
+*/
+
+#include <stdbool.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define main rings_main
+#include "../src/c/main.c"
+#undef main
+
+#define replay_epoch 1767571200  //Mon 2026-01-05 00:00:00 UTC
+#define minutes_per_day (24 * 60)
+
+typedef struct {
+  const char *name;
+  int days;
+  void (*minute)(int minute);  //events half way through each minute, after its tick, counted from the start
+} Scenario;
+
+typedef struct {
+  const char *name;
+  size_t offset;
+} Counter;
+
+#define COUNTER(field) { #field, offsetof(StubCounters, field) }
+
+static const Counter counters[] = {
+  COUNTER(layer_mark_dirty),
+  COUNTER(frames),
+  COUNTER(pixels),
+  COUNTER(fill_radial),
+  COUNTER(health_queries),
+  COUNTER(persist_writes),
+  COUNTER(vibes),
+  COUNTER(outbox_sends),
+};
+
+#define num_counters (sizeof(counters) / sizeof(counters[0]))
+
+static uint32_t counter_value(const StubCounters *values, int counter) {
+  return *(const uint32_t *)((const uint8_t *)values + counters[counter].offset);
+}
+
+//the state of the simulated watch, shared by the scenario scripts
+static BatteryChargeState battery = { .charge_percent = 100 };
+static int battery_minutes;  //since the level last moved
+static HealthValue steps_today;
+
+static void battery_drain(int minutes_per_percent) {
+  //about a week from full with the default rate
+  if(battery.is_charging || (battery.charge_percent == 0)) return;
+  if(++battery_minutes < minutes_per_percent) return;
+  battery_minutes = 0;
+  battery.charge_percent--;
+  stub_battery_event(battery);
+}
+
+static void battery_charge(int minutes_per_percent) {
+  if(++battery_minutes < minutes_per_percent) return;
+  battery_minutes = 0;
+  if(battery.charge_percent < 100) battery.charge_percent++;
+  battery.is_plugged = true;
+  battery.is_charging = (battery.charge_percent < 100);
+  stub_battery_event(battery);
+}
+
+static void battery_unplug(void) {
+  battery.is_plugged = false;
+  battery.is_charging = false;
+  battery_minutes = 0;
+  stub_battery_event(battery);
+}
+
+static void send_setting(uint32_t key, uint8_t value) {
+  //the configuration page sends each changed setting as one byte
+  DictionaryIterator *iter = stub_inbox_begin();
+  dict_write_data(iter, key, &value, 1);
+  stub_inbox_deliver();
+  stub_flush();
+}
+
+static void quick_view_peek(void) {
+  //round watches have no Quick View
+  if(PBL_IF_ROUND_ELSE(true, false)) return;
+  stub_unobstructed_animate(PBL_DISPLAY_HEIGHT - 51, 10);
+}
+
+static void quick_view_close(void) {
+  if(PBL_IF_ROUND_ELSE(true, false)) return;
+  stub_unobstructed_animate(PBL_DISPLAY_HEIGHT, 10);
+}
+
+static void wrist_flick(void) {
+  //whatever a flick shows runs until its timers end
+  stub_accel_tap();
+  stub_flush();
+  stub_advance_ms(reveal_duration * 1000);
+}
+
+static void relaunch(void) {
+  //leaving the face for a menu or a notification quits it, coming back starts it again
+  deinit();
+  init();
+  stub_flush();
+  stub_advance_ms(1000);
+}
+
+//the scenarios
+
+static void day_minute(int minute) {
+  battery_drain(100);
+}
+
+static void flapping_minute(int minute) {
+  //every 3 hours the connection drops a few times in one minute and comes back half an hour later
+  battery_drain(100);
+  if(minute % 180 == 0) {
+    for(int flap = 0; flap < 5; flap++) {
+      stub_connection_event(flap % 2);
+      stub_flush();
+    }
+  }
+  if(minute % 180 == 30) {
+    stub_connection_event(true);
+    stub_flush();
+  }
+}
+
+static void peeks_minute(int minute) {
+  //a notification every 20 minutes, its Quick View shown for 5
+  battery_drain(100);
+  if(minute % 20 == 0) quick_view_peek();
+  if(minute % 20 == 5) quick_view_close();
+}
+
+static void config_minute(int minute) {
+  //a save every 2 hours, cycling through a color, a line, a toggle and a save without changes
+  battery_drain(100);
+  if(minute % 120) return;
+  switch((minute / 120) % 4) {
+    case 0: send_setting(MESSAGE_KEY_foregroundColor, 0xC0 | (minute / 120)); break;
+    case 1: send_setting(MESSAGE_KEY_topLineSetting, (minute / 120) % 7); break;
+    case 2: send_setting(MESSAGE_KEY_bluetoothIcon, (minute / 480) % 2); break;
+    case 3: send_setting(MESSAGE_KEY_centerLineSetting, settings.center_line_setting); break;
+  }
+}
+
+static void relaunch_minute(int minute) {
+  //a notification opened every 15 minutes
+  battery_drain(100);
+  if(minute % 15 == 0) relaunch();
+}
+
+static void reveal_minute(int minute) {
+  //lines only on a flick of the wrist, looked at twice an hour through the waking hours
+  battery_drain(100);
+  int minute_of_day = minute % minutes_per_day;
+  if(minute == 1) send_setting(MESSAGE_KEY_revealLines, 1);
+  if((minute_of_day >= 8 * 60) && (minute_of_day < 22 * 60) && (minute % 30 == 10)) wrist_flick();
+}
+
+static void week_minute(int minute) {
+  //worn down to 10% (through power saving below 20%), then charged back on the desk
+  if(battery.is_plugged) {
+    if(battery.charge_percent == 100) battery_unplug();
+    else battery_charge(2);
+  }
+  else if(battery.charge_percent <= 10) {
+    battery_charge(2);
+  }
+  else {
+    battery_drain(60);
+  }
+}
+
+static const Scenario scenarios[] = {
+  { "day", 1, day_minute },
+  { "flapping", 1, flapping_minute },
+  { "peeks", 1, peeks_minute },
+  { "config", 1, config_minute },
+  { "relaunch", 1, relaunch_minute },
+  { "reveal", 1, reveal_minute },
+  { "week", 7, week_minute },
+};
+
+#define num_scenarios (sizeof(scenarios) / sizeof(scenarios[0]))
+
+static void run_until(int minute) {
+  //the clock runs up to the minute, firing the timers still pending on the way
+  uint64_t target = (uint64_t)(replay_epoch + minute * 60) * 1000;
+  uint64_t now = (uint64_t)time(NULL) * 1000 + time_ms(NULL, NULL);
+  if(target > now) stub_advance_ms(target - now);
+  else stub_set_time(replay_epoch + minute * 60);
+}
+
+static void tick_to(int minute) {
+  time_t t = replay_epoch + minute * 60;
+  stub_set_time(t);
+  struct tm *tick_time = localtime(&t);
+  TimeUnits units = MINUTE_UNIT;
+  if(tick_time->tm_min == 0) units |= HOUR_UNIT;
+  if((tick_time->tm_min == 0) && (tick_time->tm_hour == 0)) units |= DAY_UNIT;
+  stub_tick_handler()(tick_time, units);
+}
+
+static void walk(int minute) {
+  //steps through the waking hours, reported every 5 minutes like the health service's movement updates
+  int minute_of_day = minute % minutes_per_day;
+  if((minute_of_day < 8 * 60) || (minute_of_day >= 22 * 60) || (minute % 5)) return;
+  if(minute_of_day == 8 * 60) steps_today = 0;
+  steps_today += 40;
+  stub_set_health(HealthMetricStepCount, steps_today);
+  stub_set_health(HealthMetricWalkedDistanceMeters, steps_today * 3 / 4);
+  stub_set_health(HealthMetricActiveKCalories, steps_today / 25);
+  stub_health_event(HealthEventMovementUpdate);
+  stub_flush();
+}
+
+#if heap_accounting
+static void print_heap_accounting(const Scenario *scenario) {
+  //a second load and unload, after which nothing should be left; the rest is from the scenario
+  HeapAccounting replayed = accounting;
+  init();
+  stub_flush();
+  deinit();
+
+  int32_t alive = 0;
+  for(int kind = 0; kind < num_allocation_kinds; kind++)
+    alive += accounting.live[kind];
+  printf("%-8s %-10s %7u %7u %7u %7u %7u %6d", PBL_PLATFORM_NAME, scenario->name,
+         (unsigned)replayed.used[HEAP_LOADED], (unsigned)replayed.used[HEAP_STEADY],
+         (unsigned)accounting.peak_used, (unsigned)replayed.used[HEAP_UNLOADED],
+         (unsigned)accounting.used[HEAP_DEINIT], (int)alive);
+  for(int proc = 0; proc < num_stack_procs; proc++)
+    printf(" %7u", accounting.stack_depth[proc]);
+  printf("\n");
+  fflush(stdout);
+}
+#endif
+
+static StubCounters run_scenario(const Scenario *scenario) {
+  /*
+  Loads the face at midnight and replays the scenario minute by minute.
+  Loading is left out of the counts; a day is what is measured
+  */
+  setenv("TZ", "UTC", 1);
+  tzset();
+  srand(1);
+  stub_set_time(replay_epoch);
+  stub_battery_event(battery);
+  stub_connection_event(true);
+  init();
+  stub_flush();
+  stub_reset();
+
+  for(int minute = 1; minute <= scenario->days * minutes_per_day; minute++) {
+    run_until(minute);
+    tick_to(minute);
+    stub_flush();
+    stub_advance_ms(30 * 1000);
+    walk(minute);
+    scenario->minute(minute);
+    stub_flush();
+  }
+
+  StubCounters counted = stub_counters;
+  deinit();
+#if heap_accounting
+  print_heap_accounting(scenario);
+#endif
+  return counted;
+}
+
+static bool run_isolated(const Scenario *scenario, StubCounters *counted) {
+  //a child process gets the face's statics as they were before anything was loaded
+  fflush(stdout);
+  int fds[2];
+  if(pipe(fds)) return false;
+  pid_t pid = fork();
+  if(pid < 0) return false;
+  if(pid == 0) {
+    close(fds[0]);
+    StubCounters values = run_scenario(scenario);
+    ssize_t written = write(fds[1], &values, sizeof(values));
+    _exit(written == sizeof(values) ? 0 : 1);
+  }
+  close(fds[1]);
+  ssize_t got = read(fds[0], counted, sizeof(*counted));
+  close(fds[0]);
+  int status;
+  waitpid(pid, &status, 0);
+  return (got == sizeof(*counted)) && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+static bool find_budget(FILE *budgets, const char *scenario, const char *counter, uint32_t *budget) {
+  //lines are "platform scenario counter budget", # starts a comment
+  char line[128], platform[16], name[32], field[32];
+  unsigned long value;
+  rewind(budgets);
+  while(fgets(line, sizeof(line), budgets)) {
+    if(line[0] == '#') continue;
+    if(sscanf(line, "%15s %31s %31s %lu", platform, name, field, &value) != 4) continue;
+    if(!strcmp(platform, PBL_PLATFORM_NAME) && !strcmp(name, scenario) && !strcmp(field, counter)) {
+      *budget = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  const char *budget_path = NULL;
+  bool update = false;
+  int opt;
+  while((opt = getopt(argc, argv, "b:u")) != -1) {
+    switch(opt) {
+      case 'b': budget_path = optarg; break;
+      case 'u': update = true; break;
+      default:
+        fprintf(stderr, "usage: %s [-b budgets] [-u] [scenario...]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  FILE *budgets = NULL;
+  if(budget_path && !(budgets = fopen(budget_path, "r"))) {
+    perror(budget_path);
+    return 2;
+  }
+
+  if(heap_accounting) {
+    printf("%-8s %-10s %7s %7s %7s %7s %7s %6s %7s %7s %7s %7s\n", "platform", "scenario", "loaded",
+           "steady", "peak", "unload", "deinit", "alive", "s:ring", "s:batt", "s:bt", "s:line");
+  }
+  else if(!update) {
+    printf("%-8s %-10s", "platform", "scenario");
+    for(size_t counter = 0; counter < num_counters; counter++)
+      printf(" %*s", counter ? 10 : 16, counters[counter].name);
+    printf("\n");
+  }
+
+  int over = 0;
+  for(size_t i = 0; i < num_scenarios; i++) {
+    const Scenario *scenario = &scenarios[i];
+    if(optind < argc) {
+      bool wanted = false;
+      for(int arg = optind; arg < argc; arg++)
+        wanted |= !strcmp(argv[arg], scenario->name);
+      if(!wanted) continue;
+    }
+
+    StubCounters counted;
+    if(!run_isolated(scenario, &counted)) {
+      fprintf(stderr, "%s: scenario %s did not finish\n", PBL_PLATFORM_NAME, scenario->name);
+      return 1;
+    }
+
+    if(heap_accounting) {
+      continue;
+    }
+    if(update) {
+      for(size_t counter = 0; counter < num_counters; counter++)
+        printf("%s %s %s %u\n", PBL_PLATFORM_NAME, scenario->name, counters[counter].name,
+               counter_value(&counted, counter));
+      continue;
+    }
+
+    printf("%-8s %-10s", PBL_PLATFORM_NAME, scenario->name);
+    for(size_t counter = 0; counter < num_counters; counter++)
+      printf(" %*u", counter ? 10 : 16, counter_value(&counted, counter));
+    printf("\n");
+
+    for(size_t counter = 0; budgets && (counter < num_counters); counter++) {
+      uint32_t budget, value = counter_value(&counted, counter);
+      if(find_budget(budgets, scenario->name, counters[counter].name, &budget) && (value > budget)) {
+        printf("%-8s %-10s %s %u is over its budget of %u\n", PBL_PLATFORM_NAME, scenario->name,
+               counters[counter].name, value, budget);
+        over++;
+      }
+    }
+  }
+
+  if(budgets) fclose(budgets);
+  return over ? 1 : 0;
+}
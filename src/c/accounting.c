@@ -0,0 +1,134 @@
+#include <pebble.h>
+#include "accounting.h"
+
+#if heap_accounting
+
+//the wrappers below call the real functions
+#undef window_create
+#undef window_destroy
+#undef layer_create
+#undef layer_destroy
+#undef gbitmap_create_blank
+#undef gbitmap_create_blank_with_palette
+#undef gbitmap_destroy
+
+#ifndef stack_probe_size
+  #define stack_probe_size 1024  //bytes painted below an update proc, deeper use reads as this
+#endif
+#define stack_pattern    0xA5
+
+HeapAccounting accounting;
+
+static const char *checkpoint_names[num_heap_checkpoints] = { "init", "loaded", "steady", "unloaded", "deinit" };
+static const char *allocation_names[num_allocation_kinds] = { "windows", "layers", "bitmaps" };
+static const char *stack_proc_names[num_stack_procs] = { "ring", "battery", "bt icon", "line" };
+
+static void note_peak(void){
+  uint32_t used = heap_bytes_used();
+  if(used > accounting.peak_used) accounting.peak_used = used;
+}
+
+void accounting_checkpoint(int checkpoint){
+  accounting.used[checkpoint] = heap_bytes_used();
+  accounting.free[checkpoint] = heap_bytes_free();
+  note_peak();
+}
+
+void accounting_report(const char *when){
+  APP_LOG(APP_LOG_LEVEL_INFO, "heap accounting %s, peak %d used", when, (int)accounting.peak_used);
+  for(int checkpoint = 0; checkpoint < num_heap_checkpoints; checkpoint++)
+    if(accounting.free[checkpoint])  //not reached yet otherwise
+      APP_LOG(APP_LOG_LEVEL_INFO, "  %-8s %6d used %6d free", checkpoint_names[checkpoint],
+              (int)accounting.used[checkpoint], (int)accounting.free[checkpoint]);
+  for(int kind = 0; kind < num_allocation_kinds; kind++)
+    APP_LOG(accounting.live[kind] ? APP_LOG_LEVEL_WARNING : APP_LOG_LEVEL_INFO, "  %-8s %6d created %6d alive",
+            allocation_names[kind], (int)accounting.created[kind], (int)accounting.live[kind]);
+  for(int proc = 0; proc < num_stack_procs; proc++)
+    APP_LOG(APP_LOG_LEVEL_INFO, "  stack below %s update proc: %d bytes", stack_proc_names[proc],
+            (int)accounting.stack_depth[proc]);
+}
+
+/*
+Both functions have the same frame and are called from the same depth,
+so the area of one lies where the area of the other was. The stack
+grows down, so whatever the update proc called in between overwrote
+the painted area from its top; what is left of the pattern at the
+bottom is what was never reached
+*/
+
+static __attribute__((noinline)) void stack_paint(volatile uint8_t *area){
+  for(int i = 0; i < stack_probe_size; i++)
+    area[i] = stack_pattern;
+}
+
+static __attribute__((noinline)) int stack_untouched(volatile uint8_t *area){
+  int untouched = 0;
+  while((untouched < stack_probe_size) && (area[untouched] == stack_pattern))
+    untouched++;
+  return untouched;
+}
+
+__attribute__((noinline)) void accounting_stack_begin(void){
+  volatile uint8_t area[stack_probe_size];
+  stack_paint(area);
+}
+
+__attribute__((noinline)) void accounting_stack_end(int proc){
+  volatile uint8_t area[stack_probe_size];
+  uint16_t depth = stack_probe_size - stack_untouched(area);
+  if(depth > accounting.stack_depth[proc]) accounting.stack_depth[proc] = depth;
+  note_peak();
+}
+
+static void count_created(int kind, void *created){
+  if(!created) return;
+  accounting.created[kind]++;
+  accounting.live[kind]++;
+  note_peak();
+}
+
+static void count_destroyed(int kind, void *destroyed){
+  if(destroyed) accounting.live[kind]--;
+}
+
+Window *accounting_window_create(void){
+  Window *window = window_create();
+  count_created(ALLOCATION_WINDOW, window);
+  return window;
+}
+
+void accounting_window_destroy(Window *window){
+  count_destroyed(ALLOCATION_WINDOW, window);
+  window_destroy(window);
+}
+
+Layer *accounting_layer_create(GRect frame){
+  Layer *layer = layer_create(frame);
+  count_created(ALLOCATION_LAYER, layer);
+  return layer;
+}
+
+void accounting_layer_destroy(Layer *layer){
+  count_destroyed(ALLOCATION_LAYER, layer);
+  layer_destroy(layer);
+}
+
+GBitmap *accounting_gbitmap_create_blank(GSize size, GBitmapFormat format){
+  GBitmap *bitmap = gbitmap_create_blank(size, format);
+  count_created(ALLOCATION_BITMAP, bitmap);
+  return bitmap;
+}
+
+GBitmap *accounting_gbitmap_create_blank_with_palette(GSize size, GBitmapFormat format, GColor *palette,
+                                                      bool free_on_destroy){
+  GBitmap *bitmap = gbitmap_create_blank_with_palette(size, format, palette, free_on_destroy);
+  count_created(ALLOCATION_BITMAP, bitmap);
+  return bitmap;
+}
+
+void accounting_gbitmap_destroy(GBitmap *bitmap){
+  count_destroyed(ALLOCATION_BITMAP, bitmap);
+  gbitmap_destroy(bitmap);
+}
+
+#endif
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <pebble.h>
+
+/*
+Heap and stack accounting, for hard numbers on what the face costs in
+memory before a cache or bitmap is added. It is off unless
+heap_accounting is defined as true (or built with
+-Dheap_accounting=true), and then compiles to nothing. When on:
+
+- the heap is recorded at init, after the window loads, on every tick
+  (steady state), after it unloads and after deinit, along with the
+  highest use seen;
+- windows, layers and bitmaps created by the face are counted through
+  wrappers, so a create without its destroy shows as a leak;
+- each update proc reports how deep the stack went below it, found by
+  painting the stack before the proc draws and reading it back after.
+
+accounting_report logs all of it
+*/
+
+#ifndef heap_accounting
+  #define heap_accounting false
+#endif
+
+enum { HEAP_INIT, HEAP_LOADED, HEAP_STEADY, HEAP_UNLOADED, HEAP_DEINIT, num_heap_checkpoints };
+enum { ALLOCATION_WINDOW, ALLOCATION_LAYER, ALLOCATION_BITMAP, num_allocation_kinds };
+enum { STACK_RING, STACK_BATTERY, STACK_BT_ICON, STACK_LINE, num_stack_procs };
+
+typedef struct {
+  uint32_t used[num_heap_checkpoints];   //heap_bytes_used at each checkpoint, last time it was passed
+  uint32_t free[num_heap_checkpoints];
+  uint32_t peak_used;
+  uint32_t created[num_allocation_kinds];
+  int32_t live[num_allocation_kinds];    //created and not yet destroyed
+  uint16_t stack_depth[num_stack_procs]; //bytes, the deepest seen
+} HeapAccounting;
+
+#if heap_accounting
+
+extern HeapAccounting accounting;
+
+void accounting_checkpoint(int checkpoint);
+//logs every figure, and any window, layer or bitmap still alive
+void accounting_report(const char *when);
+
+//called first and last in an update proc, at the same depth
+void accounting_stack_begin(void);
+void accounting_stack_end(int proc);
+
+Window *accounting_window_create(void);
+void accounting_window_destroy(Window *window);
+Layer *accounting_layer_create(GRect frame);
+void accounting_layer_destroy(Layer *layer);
+GBitmap *accounting_gbitmap_create_blank(GSize size, GBitmapFormat format);
+GBitmap *accounting_gbitmap_create_blank_with_palette(GSize size, GBitmapFormat format, GColor *palette,
+                                                      bool free_on_destroy);
+void accounting_gbitmap_destroy(GBitmap *bitmap);
+
+//everything including this header creates and destroys through the counting wrappers
+#define window_create accounting_window_create
+#define window_destroy accounting_window_destroy
+#define layer_create accounting_layer_create
+#define layer_destroy accounting_layer_destroy
+#define gbitmap_create_blank accounting_gbitmap_create_blank
+#define gbitmap_create_blank_with_palette accounting_gbitmap_create_blank_with_palette
+#define gbitmap_destroy accounting_gbitmap_destroy
+
+#else
+
+#define accounting_checkpoint(checkpoint)
+#define accounting_report(when)
+#define accounting_stack_begin()
+#define accounting_stack_end(proc)
+
+#endif
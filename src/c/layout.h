@@ -0,0 +1,72 @@
+#pragma once
+
+#include <pebble.h>
+
+/*
+Screen geometry for the face. Everything is derived from the display
+size of the platform being built, so aplite, basalt and diorite
+(144x168) and chalk (180x180) each get a constant table worked out by
+the compiler, and nothing has to be measured or divided at runtime.
+Only the rings and the bluetooth icon still follow the unobstructed
+area while Quick View is up
+*/
+
+//for modifying graphics
+#define gap_width               1  //pixels (the gap between the rings)
+#define line_one_offset        21  //pixels (For font GOTHIC_18_BOLD)
+#define line_one_offset_small  18  //pixels (For font GOTHIC_14_BOLD))
+#define line_two_offset         3  //pixels (For font GOTHIC_18_BOLD)
+#define line_two_offset_small   1  //pixels (For font GOTHIC_14_BOLD))
+
+#define layout_width    PBL_DISPLAY_WIDTH
+#define layout_height   PBL_DISPLAY_HEIGHT
+#define layout_center_x (layout_width/2)
+#define layout_center_y (layout_height/2)
+#define layout_ring     (layout_width/6)  //pixels (one ring plus its gap)
+
+/*
+The rings are circles fitted to the width of the screen, so on chalk
+they are inscribed in the round display and need no extra inset. Only
+the thin seconds ring is kept clear of chalk's bezel
+*/
+typedef struct {
+  int16_t ring_inset;                 //from the outer ring's bounds to the inner ring's
+  int16_t ring_thickness;
+  int16_t seconds_ring_inset;         //from the outer ring's bounds
+  int16_t seconds_ring_thickness;
+  GRect line_frames[2][2];            //[line][small font]
+  const char *line_fonts[2];          //[small font]
+  GRect center_bar_frame;
+  int16_t center_bar_half_length;
+  int16_t bt_icon_radius;
+  int16_t bt_symbol_half_width;
+  int16_t bt_symbol_half_height;
+  int16_t bt_symbol_arm;              //from the center to where the diagonals meet the sides
+} Layout;
+
+static const Layout layout = {
+  .ring_inset = layout_ring,
+  .ring_thickness = layout_ring - gap_width,
+  //the seconds ring runs along the outer edge of the minute ring
+  .seconds_ring_inset = PBL_IF_ROUND_ELSE(3, 1),
+  .seconds_ring_thickness = 2,
+  .line_frames = {
+    {
+      {{layout_center_x - layout_ring, layout_center_y - line_one_offset}, {2*layout_ring, line_one_offset}},
+      {{layout_center_x - layout_ring, layout_center_y - line_one_offset_small}, {2*layout_ring, line_one_offset_small}}
+    },
+    {
+      {{layout_center_x - layout_ring, layout_center_y - line_two_offset}, {2*layout_ring, layout_ring}},
+      {{layout_center_x - layout_ring, layout_center_y - line_two_offset_small}, {2*layout_ring, layout_ring}}
+    }
+  },
+  .line_fonts = { FONT_KEY_GOTHIC_18_BOLD, FONT_KEY_GOTHIC_14_BOLD },
+  //only as large as the longest center line, so its redraws stay small
+  .center_bar_frame = {{layout_center_x - layout_ring, layout_center_y}, {2*layout_ring + 1, 1}},
+  .center_bar_half_length = layout_ring,
+  //the icon fills the inner ring's hole
+  .bt_icon_radius = layout_ring - gap_width,
+  .bt_symbol_half_width = layout_width*6/100,
+  .bt_symbol_half_height = layout_width/8,
+  .bt_symbol_arm = layout_width/16
+};
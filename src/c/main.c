@@ -1,10 +1,13 @@
 #include <pebble.h>
+#include "layout.h"
+#include "ring_spans.h"
+#include "accounting.h"
 
 /*
-Settings from the Clay framework come in as CStrings, but
-are immediately converted to coded integer equivilents to save
-processor power later, as well as memory space. The following
-three blocks lay the foundation for this process
+Settings are sent from the phone already as these coded integers,
+one byte each, so nothing is parsed on the watch. The tables in
+src/pkjs/app.js list the configuration page's values in the same
+order and have to be kept in step with the following three blocks
 */
 
 //color settings
@@ -14,6 +17,7 @@ three blocks lay the foundation for this process
 #define LIGHT 3
 #define HOT 4
 #define COLD 5
+#define num_color_settings 6
 
 //complication settings
 #define DIGITAL 0
@@ -27,18 +31,51 @@ three blocks lay the foundation for this process
 #define METERS 8
 #define FEET 9
 #define CALORIES 10
+#if defined(PBL_HEALTH)
+  #define num_complications 11
+#else
+  #define num_complications 7  //the health complications are left out without a health service
+#endif
+
+//complication update cadences (when a complication's text can change)
+#define CADENCE_MINUTE 0
+#define CADENCE_DAY 1
+#define CADENCE_HEALTH 2
 
 //center line settings
 #define BATTERY 0
 #define CONSTANT 1
 #define NONE 2
+#define num_center_line_settings 3
+
+//for configuration messages
+#define num_setting_keys 15  //every message key the configuration page sends
+#define settings_inbox_size (1 + num_setting_keys*(7 + 1))  //a 7 byte header and one byte for each
+
+//for incremental ring drawing
+#define incremental_rings    true  //only fill the newly covered wedge each minute
+#define ring_overlap_angle DEG_TO_TRIGANGLE(1)  //the end of a restored arc filled again to cover its antialiasing
+#ifndef span_rings
+  #define span_rings         false  //fill the rings from span tables straight into 8 bit framebuffers
+#endif
+
+//for the complication lines' glyph atlases (every character the built-in complications show in English)
+#define line_glyphs      "0123456789:/, ADFJMNOSTWabcdeghilnoprtuvy"
+#define num_line_glyphs  (sizeof(line_glyphs) - 1)
+#define glyph_margin     1  //pixels kept either side of a glyph's advance, for ink that overhangs it
+#define line_width_unknown -2  //a line's width until it is first drawn (-1 is a character without a glyph)
+
+//for health complications (a line is only rewritten once its value has moved this far)
+#define steps_threshold        10  //steps
+#define distance_threshold     10  //meters
+#define calories_threshold      1  //kilocalories
 
-//for modifying graphics 
-#define gap_width               1  //pixels (the gap between the rings)
-#define line_one_offset        21  //pixels (For font GOTHIC_18_BOLD)
-#define line_one_offset_small  18  //pixels (For font GOTHIC_14_BOLD))
-#define line_two_offset         3  //pixels (For font GOTHIC_18_BOLD)
-#define line_two_offset_small   1  //pixels (For font GOTHIC_14_BOLD))
+//health metrics cached for the complications
+#define HEALTH_STEPS 0
+#define HEALTH_DISTANCE 1
+#define HEALTH_CALORIES 2
+#define NO_HEALTH_METRIC -1
+#define num_health_metrics 3
 
 //number of random colors in each group
 #define num_dark_colors 8
@@ -46,23 +83,264 @@ three blocks lay the foundation for this process
 #define num_hot_colors 6
 #define num_cold_colors 6
 
+//for the seconds ring
+#define seconds_ring_duration  15  //seconds (the ring runs this long after a flick of the wrist)
+#define seconds_ring_fps        4  //frames each second at most while it runs
+
+//for bluetooth
+#define bt_debounce_interval    5  //seconds (a change of connection has to last this long to be shown)
+
+//for revealing the lines
+#define reveal_duration         5  //seconds (the lines stay up this long after a flick of the wrist)
+
+//for the hourly color rotation
+#define palette_hours          24  //hours of colors picked ahead of time
+
+//for power saving
+#define power_save_interval     5  //minutes (the rings are only redrawn this often while saving power)
+
+//for persistent storage
+#define SETTINGS_KEY 1      //all settings live in one blob under this key
+#define SETTINGS_VERSION 5  //bump when fields are appended to Settings
+#define SNAPSHOT_KEY 2      //the face as it was last shown
+#define SNAPSHOT_VERSION 1  //bump when Snapshot changes
+#define TELEMETRY_KEY 3     //where the telemetry stood at unload, its hours in the keys after it
+
+//for the redraw scheduler, reasons and the elements they touch are collected as bitmasks
+#define REDRAW_TIME         (1 << 0)
+#define REDRAW_SECONDS      (1 << 1)
+#define REDRAW_TEXT         (1 << 2)
+#define REDRAW_LAYOUT       (1 << 3)
+#define REDRAW_BATTERY      (1 << 4)
+#define REDRAW_CONNECTION   (1 << 5)
+#define REDRAW_COLORS       (1 << 6)
+#define REDRAW_SETTINGS     (1 << 7)
+#define REDRAW_POWER_SAVING (1 << 8)
+#define num_redraw_reasons 9
+#define ELEMENT_RING        (1 << 0)
+#define ELEMENT_LINE_ONE    (1 << 1)
+#define ELEMENT_LINE_TWO    (1 << 2)
+#define ELEMENT_BATTERY     (1 << 3)
+#define ELEMENT_BT_ICON     (1 << 4)
+#define num_elements 5
+#define ELEMENTS_ALL ((1 << num_elements) - 1)
+#ifndef log_redraws
+  #define log_redraws    false  //log the reasons behind every frame
+#endif
+
+//for telemetry (opt-in, recorded and stored only while enabled)
+#define TELEMETRY_RING 0
+#define TELEMETRY_BATTERY 1
+#define TELEMETRY_BT_ICON 2
+#define TELEMETRY_LINE_ONE 3
+#define TELEMETRY_LINE_TWO 4
+#define num_telemetry_layers 5
+#define num_telemetry_slots    24  //hours of history in the ring buffer
+#define num_draw_time_buckets   6  //0, 1, 2-3, 4-7, 8-15 and 16+ milliseconds
+#define TELEMETRY_FORMAT 3         //bump when the summary layout changes
+#define telemetry_summary_size (2 + 4*(3*num_telemetry_layers + 6 + num_draw_time_buckets) + 2*num_telemetry_slots)
+#define telemetry_slots_per_key (PERSIST_DATA_MAX_LENGTH / sizeof(TelemetrySlot))
+#define num_telemetry_keys ((num_telemetry_slots + telemetry_slots_per_key - 1) / telemetry_slots_per_key)
+
+/*
+Every setting the configuration page can change. The struct is
+written and read as a single blob, so fields are only ever appended:
+a blob from an older version is then a prefix of the current one
+*/
+typedef struct {
+  uint8_t version;
+  uint8_t color_setting;
+  GColor bg_color;
+  GColor fg_color;
+  uint8_t line_one_setting;
+  uint8_t line_two_setting;
+  uint8_t center_line_setting;
+  bool bluetooth_vibes;
+  bool bluetooth_icon;
+  //version 2
+  uint8_t power_save_battery;  //percent, 0 disables
+  bool quiet_hours;
+  uint8_t quiet_start;         //hour of the day
+  uint8_t quiet_end;           //hour of the day
+  //version 3
+  bool telemetry;
+  //version 4
+  bool seconds_ring;
+  //version 5
+  bool reveal_lines;           //the lines only show after a flick of the wrist
+} Settings;
+
+/*
+One hour of telemetry. The slots form a ring buffer, so the face
+always holds the last num_telemetry_slots hours and nothing older
+*/
+typedef struct {
+  uint16_t redraws[num_telemetry_layers];
+  uint16_t draw_ms[num_telemetry_layers];      //total
+  uint16_t max_draw_ms[num_telemetry_layers];
+  uint16_t draw_time_histogram[num_draw_time_buckets];
+  uint16_t health_queries;
+  uint16_t persist_writes;
+  uint16_t inbox_messages;
+  uint16_t inbox_bytes;
+  uint16_t bt_flaps;         //connection changes undone before they were shown
+  uint16_t bt_vibes_saved;   //of those, disconnects that would have vibrated
+} TelemetrySlot;
+
+//where the ring buffer stood when it was stored; the slots follow under the keys after TELEMETRY_KEY
+typedef struct {
+  uint8_t format;            //TELEMETRY_FORMAT of the stored slots
+  uint8_t slot;
+  uint8_t slots_used;
+  int32_t saved_at;          //time() at unload
+} TelemetryHeader;
+
+/*
+Every glyph a complication line can show, in one of the line fonts,
+rendered once into a 1 bit bitmap. A line is drawn by blitting the
+cells of its characters, so changing it never lays text out again
+*/
+typedef struct {
+  GBitmap *bitmap;                   //NULL until a line in this font is first drawn
+  bool measured;
+  int16_t height;
+  uint16_t x[num_line_glyphs];       //where each glyph's cell starts in the bitmap
+  uint8_t advance[num_line_glyphs];
+} GlyphAtlas;
+
+//the text of a complication line, already looked up in its atlas
+typedef struct {
+  char text[16];
+  bool small;                        //shown in the small font
+  uint8_t length;
+  uint8_t glyphs[16];                //each character's place in line_glyphs
+  int16_t width;                     //the advances added up, -1 when a character has no glyph
+                                     //and line_width_unknown until the line is first drawn
+} LineText;
+
+//one hour of the color schedule
+typedef struct {
+  GColor background;
+  GColor foreground;
+} PaletteEntry;
+
+/*
+The time of the last minute tick, broken down once and read by
+everything that shows the time until the next tick, so the rings and
+the lines always show the same minute
+*/
+typedef struct {
+  struct tm tm;                      //local time
+  int32_t minute_angle, hour_angle;  //TRIG_MAX_ANGLE units
+  TimeUnits crossed;                 //the boundaries the tick crossed
+} TimeContext;
+
+/*
+The face as it was when the window last unloaded. The next load draws
+its first frame from this, and only asks the battery, connection and
+health services once that frame is out
+*/
+typedef struct {
+  uint8_t version;
+  uint8_t color_setting;             //the schedule below was picked for this setting
+  uint8_t palette_hour;
+  uint8_t battery_level;
+  bool battery_charging;
+  bool bt_connected;
+  bool power_saving;
+  uint8_t line_settings[2];          //the complications line_text was formatted for
+  int32_t saved_at;                  //time() at unload
+  PaletteEntry palette_schedule[palette_hours];
+  char line_text[2][16];
+} Snapshot;
+
 //variables for app function
 static Window *main_window;
 static Layer *ring_layer, *battery_layer, *bt_icon_layer;
-static TextLayer *line_one_layer, *line_two_layer;
+static Layer *line_one_layer, *line_two_layer;
 static uint8_t battery_level;
+static bool battery_charging;
 static bool bt_connected;
+static bool power_saving;
 
 //variables for configuration
-static GColor background_color, foreground_color, bg_color_settings, fg_color_settings;
-static bool bluetooth_vibes_bool, bluetooth_icon_bool;
-static uint8_t color_setting, line_one_setting, line_two_setting, center_line_setting;
+static GColor background_color, foreground_color;
+static Settings settings;
+static TimeContext time_context;
+static PaletteEntry palette_schedule[palette_hours];
+static uint8_t palette_hour;  //entry of the schedule being shown
+
+//variables for the health complication cache
+#if defined(PBL_HEALTH)
+static HealthValue health_values[num_health_metrics];
+static bool health_value_valid[num_health_metrics];
+static HealthValue line_health_value[2];  //value each line was last formatted with
+#endif
+static bool health_events_subscribed;
+static bool line_health_valid[2];
+static uint32_t health_queries, health_queries_skipped, text_relayouts_skipped;
+
+//variables for incremental ring drawing
+static uint8_t *ring_cache;  //framebuffer rows as they were right after the rings were last drawn
+static bool ring_cache_valid;
+static int32_t cached_minute_angle, cached_hour_angle, cached_seconds_angle;  //TRIG_MAX_ANGLE units
+static GRect cached_ring_bounds;
+static GColor cached_background_color, cached_foreground_color;
+static RingSpans ring_spans[2];  //minute and hour ring tables, for span_rings
+
+//variables for the complication lines
+static LineText line_texts[2];
+static GlyphAtlas glyph_atlases[2];  //[small font]
+
+//variables for the sprite cache (the icon and bar are drawn once per color scheme, then blitted)
+static GBitmap *bt_icon_sprite;     //transparent outside the icon's circle on color displays
+#if defined(PBL_BW)
+static GBitmap *bt_icon_mask;       //1 bit bitmaps have no transparency, so the circle is cleared through this first
+#endif
+static GBitmap *center_bar_sprite;  //a full length bar, cut to the battery level when drawn
+
+//variables for bluetooth debouncing
+static AppTimer *bt_debounce_timer;
+static bool bt_reported;  //the connection as last reported, bt_connected is the one shown
+static uint32_t bt_flaps, bt_vibes_saved;
+
+//variables for the redraw scheduler
+static AppTimer *redraw_timer;  //pending until the event being handled is done
+static uint16_t redraw_reasons;
+static uint8_t redraw_elements;
+
+//variables for starting up
+static bool cold_start_pending;     //set at a load from the snapshot, until its first frame is drawn
+static AppTimer *cold_start_timer;  //asks the services once that frame is out
+static Snapshot stored_snapshot;    //as last read or written, so an unload that changed nothing skips the write
+static bool snapshot_stored;
+
+//variables for the seconds ring
+static AppTimer *seconds_timer;
+static uint32_t seconds_ring_until;  //clock_ms() at which the ring stops
+static bool seconds_ring_running;
+static bool obstructed;
+
+//variables for revealing the lines
+static AppTimer *reveal_timer;
+static bool lines_revealed;  //a flick of the wrist is showing them
+
+//variables for Quick View transitions
+static bool ring_transition;     //the unobstructed area is animating
+static GRect transition_bounds;  //the smaller of the areas at either end of the animation
+
+//variables for telemetry
+static TelemetrySlot *telemetry;  //NULL unless the user opted in
+static uint8_t telemetry_slot, telemetry_slots_used;
+static uint8_t telemetry_slots_touched;  //slots changed since load: the current one and those before it
 
 /*
 The following blocks lay out the exact colors
-in each random color configuration
+in each random color configuration. Black and
+white displays have no use for them
 */
 
+#if defined(PBL_COLOR)
 const uint8_t dark_colors[num_dark_colors] = {
   GColorOxfordBlueARGB8,
   GColorBlueARGB8,
@@ -100,175 +378,1055 @@ const uint8_t cold_colors[num_cold_colors] = {
   GColorCyanARGB8,
   GColorScreaminGreenARGB8
 };
+#endif
+
+/*
+The following blocks map the cached health metrics
+to the SDK and set how far each must move before a
+line showing it is rewritten
+*/
+
+#if defined(PBL_HEALTH)
+const HealthMetric health_metrics[num_health_metrics] = {
+  HealthMetricStepCount,
+  HealthMetricWalkedDistanceMeters,
+  HealthMetricActiveKCalories
+};
 
-static void set_colors(void) {
+const uint16_t health_thresholds[num_health_metrics] = {
+  steps_threshold,
+  distance_threshold,
+  calories_threshold
+};
+#endif
+
+/*
+The following block is the registry of complications, indexed by the
+value the configuration page sends for each. Each one declares how
+often its text can change, the health metric it shows (if any), and
+how its text is formatted: either a strftime format or a function
+*/
+
+typedef void (*ComplicationFormatter)(char *buffer, size_t size, HealthValue value);
+
+typedef struct {
+  uint8_t cadence;
+  int8_t metric;
+  const char *time_format;
+  ComplicationFormatter format;
+} ComplicationProvider;
+
+#if defined(PBL_HEALTH)
+static void format_count(char *buffer, size_t size, HealthValue value){
+  snprintf(buffer, size, "%d", (int)value);
+}
+
+static void format_feet(char *buffer, size_t size, HealthValue value){
+  //853/260 is within 0.003% of the feet in a meter
+  snprintf(buffer, size, "%d", (int)value * 853 / 260);
+}
+#endif
+
+const ComplicationProvider complication_providers[num_complications] = {
+  [DIGITAL]      = { CADENCE_MINUTE, NO_HEALTH_METRIC, NULL,     NULL },
+  [MONTH]        = { CADENCE_DAY,    NO_HEALTH_METRIC, "%b",     NULL },
+  [DATE]         = { CADENCE_DAY,    NO_HEALTH_METRIC, "%e",     NULL },
+  [WEEKDAY]      = { CADENCE_DAY,    NO_HEALTH_METRIC, "%a",     NULL },
+  [MONTH_DATE]   = { CADENCE_DAY,    NO_HEALTH_METRIC, "%m/%e",  NULL },
+  [DATE_MONTH]   = { CADENCE_DAY,    NO_HEALTH_METRIC, "%e/%m",  NULL },
+  [WEEKDAY_DATE] = { CADENCE_DAY,    NO_HEALTH_METRIC, "%a, %e", NULL },
+#if defined(PBL_HEALTH)
+  [STEPS]        = { CADENCE_HEALTH, HEALTH_STEPS,     NULL,     format_count },
+  [METERS]       = { CADENCE_HEALTH, HEALTH_DISTANCE,  NULL,     format_count },
+  [FEET]         = { CADENCE_HEALTH, HEALTH_DISTANCE,  NULL,     format_feet },
+  [CALORIES]     = { CADENCE_HEALTH, HEALTH_CALORIES,  NULL,     format_count }
+#endif
+};
+
+#if defined(PBL_HEALTH)
+static int health_metric_for_setting(int setting){
+  if((setting < 0) || (setting >= num_complications))
+    return NO_HEALTH_METRIC;
+  return complication_providers[setting].metric;
+}
+#endif
+
+const Settings default_settings = {
+  .version = SETTINGS_VERSION,
+  .color_setting = DARK,
+  .bg_color = { GColorBlueARGB8 },
+  .fg_color = { GColorWhiteARGB8 },
+  .line_one_setting = MONTH_DATE,
+  .line_two_setting = PBL_IF_HEALTH_ELSE(STEPS, WEEKDAY),
+  .center_line_setting = BATTERY,
+  .bluetooth_vibes = true,  //vibrate
+  .bluetooth_icon = true,   //show
+  .power_save_battery = 20,
+  .quiet_hours = false,
+  .quiet_start = 22,
+  .quiet_end = 7,
+  .telemetry = false,
+  .seconds_ring = false,
+  .reveal_lines = false
+};
+
+static uint32_t clock_ms(void){
+  //milliseconds on a clock that wraps every 49 days, so only differences are meaningful
+  time_t seconds;
+  uint16_t milliseconds = time_ms(&seconds, NULL);
+  return (uint32_t)seconds * 1000 + milliseconds;
+}
+
+static void time_context_set(const struct tm *tick_time, TimeUnits units_changed){
+  //the ring angles are worked out here once, in TRIG_MAX_ANGLE units with integer math only
+  time_context.tm = *tick_time;
+  int minute = tick_time->tm_min;
+  int hour = tick_time->tm_hour % 12;  //corrects for 12 hour format
+  time_context.minute_angle = TRIG_MAX_ANGLE * minute / 60;
+  time_context.hour_angle = TRIG_MAX_ANGLE * (hour*60 + minute) / (12*60);
+  time_context.crossed = units_changed;
+}
+
+static void telemetry_add(uint16_t *counter, uint32_t amount){
+  //counters stick at their maximum rather than wrap
+  *counter = (*counter + amount > UINT16_MAX) ? UINT16_MAX : *counter + amount;
+}
+
+static TelemetrySlot *telemetry_current(void){
+  return telemetry ? &telemetry[telemetry_slot] : NULL;
+}
+
+static void telemetry_next_slot(void){
+  //called every hour, the oldest hour is overwritten
+  if(!telemetry) return;
+  telemetry_slot = (telemetry_slot + 1) % num_telemetry_slots;
+  memset(&telemetry[telemetry_slot], 0, sizeof(TelemetrySlot));
+  if(telemetry_slots_used < num_telemetry_slots) telemetry_slots_used++;
+  if(telemetry_slots_touched < num_telemetry_slots) telemetry_slots_touched++;
+}
+
+static void telemetry_restore(void){
   /*
-  This function sets the global variables background_color and foreground_color
+  This function takes the history back up from where the last unload
+  stored it. The hours that went by in between are added as empty ones,
+  so the slots stay lined up with the clock
+  */
+  TelemetryHeader header;
+  if(!telemetry ||
+     (persist_read_data(TELEMETRY_KEY, &header, sizeof(header)) != (int)sizeof(header)) ||
+     (header.format != TELEMETRY_FORMAT) || (header.slot >= num_telemetry_slots))
+    return;
+  
+  for(unsigned int key = 0; key < num_telemetry_keys; key++){
+    unsigned int first = key*telemetry_slots_per_key;
+    unsigned int count = (num_telemetry_slots - first < telemetry_slots_per_key) ?
+      num_telemetry_slots - first : telemetry_slots_per_key;
+    //a key that was never written holds hours that were never recorded
+    int size = count*sizeof(TelemetrySlot);
+    int read = persist_read_data(TELEMETRY_KEY + 1 + key, &telemetry[first], size);
+    if((read >= 0) && (read != size)){
+      memset(telemetry, 0, num_telemetry_slots*sizeof(TelemetrySlot));
+      return;
+    }
+  }
+  telemetry_slot = header.slot;
+  telemetry_slots_used = (header.slots_used < 1) ? 1 :
+    ((header.slots_used > num_telemetry_slots) ? num_telemetry_slots : header.slots_used);
+  
+  time_t now = time(NULL);
+  int32_t hours = (now >= header.saved_at) ? (now / SECONDS_PER_HOUR - header.saved_at / SECONDS_PER_HOUR) : 0;
+  for(int32_t hour = 0; (hour < hours) && (hour < num_telemetry_slots); hour++)
+    telemetry_next_slot();
+}
+
+static void telemetry_unload(void){
+  /*
+  This function stores the history as the face unloads, so its hours
+  carry on through relaunches, and frees it. Only the keys holding
+  slots that changed since the load are written
+  */
+  if(!telemetry) return;
+  
+  uint32_t keys = 0;
+  for(int i = 0; i < telemetry_slots_touched; i++)
+    keys |= 1u << (((telemetry_slot + num_telemetry_slots - i) % num_telemetry_slots) / telemetry_slots_per_key);
+  int writes = 1;
+  for(unsigned int key = 0; key < num_telemetry_keys; key++)
+    writes += (keys >> key) & 1;
+  telemetry_add(&telemetry_current()->persist_writes, writes);
+  
+  TelemetryHeader header = {
+    .format = TELEMETRY_FORMAT,
+    .slot = telemetry_slot,
+    .slots_used = telemetry_slots_used,
+    .saved_at = time(NULL)
+  };
+  persist_write_data(TELEMETRY_KEY, &header, sizeof(header));
+  for(unsigned int key = 0; key < num_telemetry_keys; key++){
+    if(!(keys & (1u << key))) continue;
+    unsigned int first = key*telemetry_slots_per_key;
+    unsigned int count = (num_telemetry_slots - first < telemetry_slots_per_key) ?
+      num_telemetry_slots - first : telemetry_slots_per_key;
+    persist_write_data(TELEMETRY_KEY + 1 + key, &telemetry[first], count*sizeof(TelemetrySlot));
+  }
+  
+  free(telemetry);
+  telemetry = NULL;
+}
+
+static void telemetry_enable(bool enable){
+  /*
+  This function starts or stops recording telemetry. Starting picks up
+  the history stored at the last unload; stopping throws the history
+  away, along with its memory and what was stored of it
+  */
+  if(enable && !telemetry){
+    telemetry = calloc(num_telemetry_slots, sizeof(TelemetrySlot));
+    telemetry_slot = 0;
+    telemetry_slots_used = 1;
+    telemetry_slots_touched = 1;
+    telemetry_restore();
+  }
+  else if(!enable && telemetry){
+    free(telemetry);
+    telemetry = NULL;
+    for(unsigned int key = 0; key <= num_telemetry_keys; key++)
+      persist_delete(TELEMETRY_KEY + key);
+  }
+}
+
+static uint32_t telemetry_draw_begin(void){
+  return telemetry ? clock_ms() : 0;
+}
+
+static void telemetry_draw_end(int layer, uint32_t started){
+  TelemetrySlot *slot = telemetry_current();
+  if(!slot) return;
+  uint32_t elapsed = telemetry_draw_begin() - started;
+  
+  int bucket = 0;
+  while((bucket < num_draw_time_buckets - 1) && (elapsed >= (1u << bucket))) bucket++;
+  
+  telemetry_add(&slot->redraws[layer], 1);
+  telemetry_add(&slot->draw_ms[layer], elapsed);
+  if(elapsed > slot->max_draw_ms[layer]) slot->max_draw_ms[layer] = (elapsed > UINT16_MAX) ? UINT16_MAX : elapsed;
+  telemetry_add(&slot->draw_time_histogram[bucket], 1);
+}
+
+static void telemetry_inbox(DictionaryIterator *iter){
+  //the size of a message is its tuples, each a 7 byte header and its value
+  TelemetrySlot *slot = telemetry_current();
+  if(!slot) return;
+  uint32_t size = 1;
+  for(Tuple *tuple = dict_read_first(iter); tuple; tuple = dict_read_next(iter))
+    size += 7 + tuple->length;
+  telemetry_add(&slot->inbox_messages, 1);
+  telemetry_add(&slot->inbox_bytes, size);
+}
+
+static uint8_t *telemetry_put(uint8_t *cursor, uint32_t value, int bytes){
+  //little endian, whatever the watch's byte order
+  for(int i = 0; i < bytes; i++)
+    *cursor++ = value >> (8*i);
+  return cursor;
+}
+
+static void telemetry_send_summary(void){
+  /*
+  This function sends the phone a summary of every recorded hour: totals
+  for each counter, the draw time histogram, and the redraws of each
+  hour (oldest first) so activity can be lined up with battery drain
+  */
+  if(!telemetry) return;
+  
+  uint32_t redraws[num_telemetry_layers] = {0}, draw_ms[num_telemetry_layers] = {0};
+  uint32_t max_draw_ms[num_telemetry_layers] = {0};
+  uint32_t histogram[num_draw_time_buckets] = {0};
+  uint32_t health_queries_total = 0, persist_writes_total = 0, inbox_messages_total = 0, inbox_bytes_total = 0;
+  uint32_t bt_flaps_total = 0, bt_vibes_saved_total = 0;
+  for(int i = 0; i < num_telemetry_slots; i++){
+    TelemetrySlot *slot = &telemetry[i];
+    for(int layer = 0; layer < num_telemetry_layers; layer++){
+      redraws[layer] += slot->redraws[layer];
+      draw_ms[layer] += slot->draw_ms[layer];
+      if(slot->max_draw_ms[layer] > max_draw_ms[layer]) max_draw_ms[layer] = slot->max_draw_ms[layer];
+    }
+    for(int bucket = 0; bucket < num_draw_time_buckets; bucket++)
+      histogram[bucket] += slot->draw_time_histogram[bucket];
+    health_queries_total += slot->health_queries;
+    persist_writes_total += slot->persist_writes;
+    inbox_messages_total += slot->inbox_messages;
+    inbox_bytes_total += slot->inbox_bytes;
+    bt_flaps_total += slot->bt_flaps;
+    bt_vibes_saved_total += slot->bt_vibes_saved;
+  }
+  
+  uint8_t summary[telemetry_summary_size];
+  uint8_t *cursor = summary;
+  cursor = telemetry_put(cursor, TELEMETRY_FORMAT, 1);
+  cursor = telemetry_put(cursor, telemetry_slots_used, 1);
+  for(int layer = 0; layer < num_telemetry_layers; layer++){
+    cursor = telemetry_put(cursor, redraws[layer], 4);
+    cursor = telemetry_put(cursor, draw_ms[layer], 4);
+    cursor = telemetry_put(cursor, max_draw_ms[layer], 4);
+  }
+  cursor = telemetry_put(cursor, health_queries_total, 4);
+  cursor = telemetry_put(cursor, persist_writes_total, 4);
+  cursor = telemetry_put(cursor, inbox_messages_total, 4);
+  cursor = telemetry_put(cursor, inbox_bytes_total, 4);
+  cursor = telemetry_put(cursor, bt_flaps_total, 4);
+  cursor = telemetry_put(cursor, bt_vibes_saved_total, 4);
+  for(int bucket = 0; bucket < num_draw_time_buckets; bucket++)
+    cursor = telemetry_put(cursor, histogram[bucket], 4);
+  for(int i = 1; i <= num_telemetry_slots; i++){
+    TelemetrySlot *slot = &telemetry[(telemetry_slot + i) % num_telemetry_slots];
+    uint32_t hour_redraws = 0;
+    for(int layer = 0; layer < num_telemetry_layers; layer++)
+      hour_redraws += slot->redraws[layer];
+    cursor = telemetry_put(cursor, (hour_redraws > UINT16_MAX) ? UINT16_MAX : hour_redraws, 2);
+  }
+  
+  DictionaryIterator *iter;
+  if(app_message_outbox_begin(&iter) != APP_MSG_OK)
+    return;
+  dict_write_data(iter, MESSAGE_KEY_telemetryData, summary, sizeof(summary));
+  app_message_outbox_send();
+}
+
+static void save_settings(void){
+  persist_write_data(SETTINGS_KEY, &settings, sizeof(settings));
+  
+  TelemetrySlot *slot = telemetry_current();
+  if(slot) telemetry_add(&slot->persist_writes, 1);
+}
+
+static void migrate_legacy_settings(void){
+  /*
+  Before the settings blob every setting had its own key, named after
+  its message key. Those values are carried over once and then removed
+  */
+  if(persist_exists(MESSAGE_KEY_backgroundColor))
+    settings.bg_color = GColorFromHEX(persist_read_int(MESSAGE_KEY_backgroundColor));
+  if(persist_exists(MESSAGE_KEY_foregroundColor))
+    settings.fg_color = GColorFromHEX(persist_read_int(MESSAGE_KEY_foregroundColor));
+  if(persist_exists(MESSAGE_KEY_colorSetting))
+    settings.color_setting = persist_read_int(MESSAGE_KEY_colorSetting);
+  if(persist_exists(MESSAGE_KEY_topLineSetting))
+    settings.line_one_setting = persist_read_int(MESSAGE_KEY_topLineSetting);
+  if(persist_exists(MESSAGE_KEY_bottomLineSetting))
+    settings.line_two_setting = persist_read_int(MESSAGE_KEY_bottomLineSetting);
+  if(persist_exists(MESSAGE_KEY_centerLineSetting))
+    settings.center_line_setting = persist_read_int(MESSAGE_KEY_centerLineSetting);
+  if(persist_exists(MESSAGE_KEY_bluetoothVibes))
+    settings.bluetooth_vibes = persist_read_bool(MESSAGE_KEY_bluetoothVibes);
+  if(persist_exists(MESSAGE_KEY_bluetoothIcon))
+    settings.bluetooth_icon = persist_read_bool(MESSAGE_KEY_bluetoothIcon);
+  
+  save_settings();
+  
+  persist_delete(MESSAGE_KEY_backgroundColor);
+  persist_delete(MESSAGE_KEY_foregroundColor);
+  persist_delete(MESSAGE_KEY_colorSetting);
+  persist_delete(MESSAGE_KEY_topLineSetting);
+  persist_delete(MESSAGE_KEY_bottomLineSetting);
+  persist_delete(MESSAGE_KEY_centerLineSetting);
+  persist_delete(MESSAGE_KEY_bluetoothVibes);
+  persist_delete(MESSAGE_KEY_bluetoothIcon);
+}
+
+static void load_settings(void){
+  /*
+  This function loads every setting with a single read. Fields missing
+  from an older, shorter blob keep their defaults
+  */
+  settings = default_settings;
+  
+  if(persist_read_data(SETTINGS_KEY, &settings, sizeof(settings)) < 0){
+    settings = default_settings;
+    migrate_legacy_settings();
+  }
+  else if(settings.version != SETTINGS_VERSION){
+    settings.version = SETTINGS_VERSION;
+    save_settings();
+  }
+  
+  //complications this platform leaves out fall back to the defaults
+  if(settings.line_one_setting >= num_complications)
+    settings.line_one_setting = default_settings.line_one_setting;
+  if(settings.line_two_setting >= num_complications)
+    settings.line_two_setting = default_settings.line_two_setting;
+}
+
+static void pick_colors(GColor *background, GColor *foreground){
+  /*
+  This function picks one background and foreground color pair
   according to the user's specified color setting
   */
+#if defined(PBL_COLOR)
   int random_picker;  //for picking random colors from variable length lists
   
-  switch(color_setting){
+  switch(settings.color_setting){
     case SELECTED_COLORS:
-      background_color = bg_color_settings;
-      foreground_color = fg_color_settings;
+      *background = settings.bg_color;
+      *foreground = settings.fg_color;
     break;
     case TRUE_RANDOM:
-      background_color = (GColor8) { .argb = ((rand() % 0b00111111) + 0b11000000) };
-      foreground_color = gcolor_legible_over(background_color);
+      *background = (GColor8) { .argb = ((rand() % 0b00111111) + 0b11000000) };
+      *foreground = gcolor_legible_over(*background);
     break;
     case DARK:
       random_picker = rand() % num_dark_colors;
-      background_color = (GColor)(dark_colors[random_picker]);
-      foreground_color = GColorWhite;
+      *background = (GColor)(dark_colors[random_picker]);
+      *foreground = GColorWhite;
     break;
     case LIGHT:
       random_picker = rand() % num_light_colors;
-      background_color = (GColor)(light_colors[random_picker]);
-      foreground_color = GColorBlack;
+      *background = (GColor)(light_colors[random_picker]);
+      *foreground = GColorBlack;
     break;
     case HOT:
       random_picker = rand() % num_hot_colors;
-      background_color = (GColor)(hot_colors[random_picker]);
-      foreground_color = gcolor_legible_over(background_color);
+      *background = (GColor)(hot_colors[random_picker]);
+      *foreground = gcolor_legible_over(*background);
     break;
     case COLD:
       random_picker = rand() % num_cold_colors;
-      background_color = (GColor)(cold_colors[random_picker]);
-      foreground_color = gcolor_legible_over(background_color);
+      *background = (GColor)(cold_colors[random_picker]);
+      *foreground = gcolor_legible_over(*background);
     break;
     default:
-      background_color = GColorBlack;
-      foreground_color = GColorWhite;
+      *background = GColorBlack;
+      *foreground = GColorWhite;
     break;
   }
+#else
+  //every palette comes down to white on black or black on white, the random ones flip a coin
+  bool light;
   
+  switch(settings.color_setting){
+    case SELECTED_COLORS:
+      *background = settings.bg_color;
+      *foreground = settings.fg_color;
+    return;
+    case TRUE_RANDOM:
+    case HOT:
+    case COLD:
+      light = rand() % 2;
+    break;
+    case LIGHT:
+      light = true;
+    break;
+    default:
+      light = false;
+    break;
+  }
+  *background = light ? GColorWhite : GColorBlack;
+  *foreground = light ? GColorBlack : GColorWhite;
+#endif
 }
 
-static void update_colors(void){
+static const char *redraw_reason_names[num_redraw_reasons] = {
+  "time", "seconds", "text", "layout", "battery", "connection", "colors", "settings", "power saving"
+};
+
+static Layer *element_layer(int element){
+  switch(element){
+    case ELEMENT_RING: return ring_layer;
+    case ELEMENT_LINE_ONE: return line_one_layer;
+    case ELEMENT_LINE_TWO: return line_two_layer;
+    case ELEMENT_BATTERY: return battery_layer;
+    case ELEMENT_BT_ICON: return bt_icon_layer;
+    default: return NULL;
+  }
+}
+
+static void redraw_resolve(void *data){
   /*
-  This function marks the appropriate layers dirty so that the
-  whole face is redrawn with new colors
+  This timer callback marks the elements the collected reasons touched,
+  once the event that raised them is done. Every element at once is a
+  single mark of the root layer
   */
+  redraw_timer = NULL;
+  
+  if(redraw_elements == ELEMENTS_ALL){
+    layer_mark_dirty(window_get_root_layer(main_window));
+  }
+  else{
+    for(int element = 1; element < (1 << num_elements); element <<= 1)
+      if(redraw_elements & element) layer_mark_dirty(element_layer(element));
+  }
+  
+  if(log_redraws){
+    char reasons[64] = "";
+    for(int reason = 0; reason < num_redraw_reasons; reason++){
+      if(!(redraw_reasons & (1 << reason))) continue;
+      if(reasons[0]) strncat(reasons, ", ", sizeof(reasons) - strlen(reasons) - 1);
+      strncat(reasons, redraw_reason_names[reason], sizeof(reasons) - strlen(reasons) - 1);
+    }
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "redraw 0x%02x for %s", (int)redraw_elements, reasons);
+  }
+  
+  redraw_elements = 0;
+  redraw_reasons = 0;
+}
+
+static void redraw(uint8_t elements, uint16_t reason){
+  /*
+  Every redraw of the face is asked for here. The elements and reasons
+  are only collected, and resolved on one timer once the event being
+  handled is done, so whatever a tick on the hour or a configuration
+  message touches is drawn in one frame, with each layer marked once
+  */
+  redraw_elements |= elements;
+  redraw_reasons |= reason;
+  if(!redraw_timer)
+    redraw_timer = app_timer_register(0, redraw_resolve, NULL);
+}
+
+static void redraw_cancel(void){
+  //for when the whole window is drawn anyway
+  if(redraw_timer)
+    app_timer_cancel(redraw_timer);
+  redraw_timer = NULL;
+  redraw_elements = 0;
+  redraw_reasons = 0;
+}
+
+static void set_colors(void){
+  //the global colors follow the schedule
+  background_color = palette_schedule[palette_hour].background;
+  foreground_color = palette_schedule[palette_hour].foreground;
+}
+
+static void schedule_colors(void){
+  /*
+  This function picks the colors for the next palette_hours hours
+  ahead of time, legibility included, so the hourly rotation is just a
+  table lookup. The first pair is shown straight away
+  */
+  for(int hour = 0; hour < palette_hours; hour++)
+    pick_colors(&palette_schedule[hour].background, &palette_schedule[hour].foreground);
+  palette_hour = 0;
   set_colors();
+}
+
+static void invalidate_ring_cache(void){
+  /*
+  This function forces the next ring_update_proc to redraw both
+  rings in full instead of only the newly covered wedge
+  */
+  ring_cache_valid = false;
+}
+
+static void invalidate_sprites(void){
+  /*
+  This function drops the pre-rendered icon and bar, so they are drawn
+  again with the current colors the next time they are shown
+  */
+  if(bt_icon_sprite) gbitmap_destroy(bt_icon_sprite);
+  if(center_bar_sprite) gbitmap_destroy(center_bar_sprite);
+  bt_icon_sprite = NULL;
+  center_bar_sprite = NULL;
+#if defined(PBL_BW)
+  if(bt_icon_mask) gbitmap_destroy(bt_icon_mask);
+  bt_icon_mask = NULL;
+#endif
+}
+
+static size_t ring_cache_row_length(GBitmap *frame_buffer, GBitmapDataRowInfo *row){
+  //1 bit rows are copied whole, 8 bit rows only between the visible edges (round displays)
+  if(gbitmap_get_format(frame_buffer) == GBitmapFormat1Bit)
+    return gbitmap_get_bytes_per_row(frame_buffer);
+  return row->max_x - row->min_x + 1;
+}
+
+static uint8_t *ring_cache_row_start(GBitmap *frame_buffer, GBitmapDataRowInfo *row){
+  if(gbitmap_get_format(frame_buffer) == GBitmapFormat1Bit)
+    return row->data;
+  return row->data + row->min_x;
+}
+
+static bool ring_cache_alloc(GBitmap *frame_buffer){
+  /*
+  This function allocates the ring cache the first time it is needed,
+  sized to hold every row of the framebuffer
+  */
+  if(ring_cache) return true;
+  
+  GRect frame_bounds = gbitmap_get_bounds(frame_buffer);
+  size_t size = 0;
+  for(int y = 0; y < frame_bounds.size.h; y++){
+    GBitmapDataRowInfo row = gbitmap_get_data_row_info(frame_buffer, y);
+    size += ring_cache_row_length(frame_buffer, &row);
+  }
+  ring_cache = malloc(size);
+  return ring_cache != NULL;
+}
 
-  //foreground
-  layer_mark_dirty(battery_layer);
-  text_layer_set_text_color(line_one_layer, foreground_color);
-  text_layer_set_text_color(line_two_layer, foreground_color);
+static void ring_cache_copy(GBitmap *frame_buffer, GRect rows, bool save, int16_t shift){
+  /*
+  This function copies the framebuffer rows covered by the rings into
+  the cache (save) or back out of it (restore). A restore can move the
+  cached rows down by shift rows (up when negative), which only works
+  where every row has the same length, so not on round displays
+  */
+  GRect frame_bounds = gbitmap_get_bounds(frame_buffer);
+  int first_row = (rows.origin.y > 0) ? rows.origin.y : 0;
+  int last_row = rows.origin.y + rows.size.h;
+  if(last_row > frame_bounds.size.h) last_row = frame_bounds.size.h;
+  
+  if(shift){
+    size_t length = gbitmap_get_bytes_per_row(frame_buffer);
+    for(int y = first_row; y < last_row; y++){
+      if((y - shift < 0) || (y - shift >= frame_bounds.size.h)) continue;
+      GBitmapDataRowInfo row = gbitmap_get_data_row_info(frame_buffer, y);
+      memcpy(row.data, ring_cache + (y - shift)*length, length);
+    }
+    return;
+  }
   
+  uint8_t *cursor = ring_cache;
+  for(int y = 0; y < last_row; y++){
+    GBitmapDataRowInfo row = gbitmap_get_data_row_info(frame_buffer, y);
+    size_t length = ring_cache_row_length(frame_buffer, &row);
+    if(y >= first_row){
+      if(save)
+        memcpy(cursor, ring_cache_row_start(frame_buffer, &row), length);
+      else
+        memcpy(ring_cache_row_start(frame_buffer, &row), cursor, length);
+    }
+    cursor += length;
+  }
+}
+
+static void update_colors(void){
+  /*
+  This function applies the current colors to every layer and
+  invalidates the whole face once, so it is redrawn with them
+  */
+  invalidate_ring_cache();
+  invalidate_sprites();
+  redraw(ELEMENTS_ALL, REDRAW_COLORS);
+
+  //the lines and sprites pick up the foreground when they are drawn
   //background
   window_set_background_color(main_window, background_color);
 }
 
+static void rotate_colors(void){
+  /*
+  This function moves the random palettes on to the next hour's colors,
+  picking a new schedule once the current one runs out
+  */
+  if(settings.color_setting == SELECTED_COLORS)
+    return;
+  
+  if(++palette_hour == palette_hours)
+    schedule_colors();
+  else
+    set_colors();
+  update_colors();
+}
+
+#if defined(PBL_HEALTH)
+static HealthValue health_value(int metric){
+  /*
+  This function returns the cached value of a health metric, only
+  asking the health service when nothing has been cached since the
+  last health event
+  */
+  if(!health_value_valid[metric]){
+    health_values[metric] = health_service_sum_today(health_metrics[metric]);
+    health_value_valid[metric] = true;
+    health_queries++;
+    
+    TelemetrySlot *slot = telemetry_current();
+    if(slot) telemetry_add(&slot->health_queries, 1);
+  }
+  else{
+    health_queries_skipped++;
+  }
+  return health_values[metric];
+}
+#endif
+
+static void invalidate_health_values(void){
+#if defined(PBL_HEALTH)
+  for(int metric = 0; metric < num_health_metrics; metric++)
+    health_value_valid[metric] = false;
+#endif
+}
+
+static void glyph_atlas_measure(int small){
+  /*
+  This function works out the advance of every glyph in a font, as the
+  width it adds between two zeros, and where its cell sits in the atlas
+  */
+  GlyphAtlas *atlas = &glyph_atlases[small];
+  if(atlas->measured)
+    return;
+  
+  GFont font = fonts_get_system_font(layout.line_fonts[small]);
+  GRect box = GRect(0, 0, 1000, 100);
+  char text[4] = "00";
+  int16_t zeros = graphics_text_layout_get_content_size(text, font, box, GTextOverflowModeWordWrap,
+                                                        GTextAlignmentLeft).w;
+  
+  uint16_t x = 0;
+  for(unsigned int glyph = 0; glyph < num_line_glyphs; glyph++){
+    text[1] = line_glyphs[glyph];
+    text[2] = '0';
+    atlas->advance[glyph] = graphics_text_layout_get_content_size(text, font, box, GTextOverflowModeWordWrap,
+                                                                  GTextAlignmentLeft).w - zeros;
+    atlas->x[glyph] = x;
+    x += atlas->advance[glyph] + 2*glyph_margin;
+  }
+  atlas->height = graphics_text_layout_get_content_size(line_glyphs, font, box, GTextOverflowModeWordWrap,
+                                                        GTextAlignmentLeft).h;
+  atlas->measured = true;
+}
+
+static void layout_line_text(LineText *line_text){
+  //looks each character up in the atlas; the advances are added up when the line is drawn
+  line_text->length = strlen(line_text->text);
+  line_text->width = line_width_unknown;
+  for(int i = 0; i < line_text->length; i++){
+    const char *glyph = strchr(line_glyphs, line_text->text[i]);
+    if(!glyph){
+      line_text->width = -1;
+      return;
+    }
+    line_text->glyphs[i] = glyph - line_glyphs;
+  }
+}
+
+static int16_t line_text_width(LineText *line_text){
+  //the font is only measured once a line in it is drawn, so a load that shows no lines never measures it
+  if(line_text->width == line_width_unknown){
+    GlyphAtlas *atlas = &glyph_atlases[line_text->small];
+    glyph_atlas_measure(line_text->small);
+    line_text->width = 0;
+    for(int i = 0; i < line_text->length; i++)
+      line_text->width += atlas->advance[line_text->glyphs[i]];
+  }
+  return line_text->width;
+}
+
+static bool lines_shown(void){
+  //with reveal_lines on, the lines are hidden until a flick of the wrist
+  return (!settings.reveal_lines) || lines_revealed;
+}
+
 static void update_lines(int setting, int layer){
   /*
   This function updates the text in either line one or line two.
   The setting input comes from the configuration page, and the
   layer input determines which layer. A value of 0 selects 
-  line_one_layer and a value of 1 selects line_two_layer
+  line_one_layer and a value of 1 selects line_two_layer.
+  Hidden lines are left alone, they are updated when revealed
   */
+  if(!lines_shown())
+    return;
   
-  static char text_buffer_one[16], text_buffer_two[16];
-  time_t now = time(NULL);
-  struct tm *t = localtime(&now);
+  HealthValue value = 0;
+#if defined(PBL_HEALTH)
+  //health lines are left alone until their value has moved past its threshold
+  int metric = health_metric_for_setting(setting);
+  if(metric != NO_HEALTH_METRIC){
+    value = health_value(metric);
+    if(line_health_valid[layer] && (abs(value - line_health_value[layer]) < health_thresholds[metric])){
+      text_relayouts_skipped++;
+      return;
+    }
+    line_health_value[layer] = value;
+    line_health_valid[layer] = true;
+  }
+  else{
+    line_health_valid[layer] = false;
+  }
+#endif
   
   char text_buffer[16];
   
-  switch(setting){
-    case DIGITAL:
-      strftime(text_buffer, sizeof(text_buffer), clock_is_24h_style() ? "%H:%M" : "%I:%M", t);
-    break;
-    case MONTH:
-      strftime(text_buffer, sizeof(text_buffer), "%b", t);
-    break;
-    case DATE:
-      strftime(text_buffer, sizeof(text_buffer), "%e", t);
-    break;
-    case WEEKDAY:
-      strftime(text_buffer, sizeof(text_buffer), "%a", t);
-    break;
-    case MONTH_DATE:
-      strftime(text_buffer, sizeof(text_buffer), "%m/%e", t);
-    break;
-    case DATE_MONTH:
-      strftime(text_buffer, sizeof(text_buffer), "%e/%m", t);
-    break;
-    case WEEKDAY_DATE:
-      strftime(text_buffer, sizeof(text_buffer), "%a, %e" , t);
-    break;
-    case STEPS:
-      snprintf(text_buffer, sizeof(text_buffer), "%d", (int)health_service_sum_today(HealthMetricStepCount));
-    break;
-    case METERS:
-      snprintf(text_buffer, sizeof(text_buffer), "%d", (int)health_service_sum_today(HealthMetricWalkedDistanceMeters));
-    break;
-    case FEET:
-      snprintf(text_buffer, sizeof(text_buffer), "%d", (int)((3.28084*(int)health_service_sum_today(HealthMetricWalkedDistanceMeters))));
-    break;
-    case CALORIES:
-      snprintf(text_buffer, sizeof(text_buffer), "%d", (int)health_service_sum_today(HealthMetricActiveKCalories));
-    break;
+  if((setting < 0) || (setting >= num_complications)){
+    strcpy(text_buffer, "error");
+  }
+  else if(complication_providers[setting].format){
+    complication_providers[setting].format(text_buffer, sizeof(text_buffer), value);
+  }
+  else{
+    //the digital time is the only format that depends on a system setting
+    const char *time_format = complication_providers[setting].time_format;
+    if(setting == DIGITAL)
+      time_format = clock_is_24h_style() ? "%H:%M" : "%I:%M";
+    strftime(text_buffer, sizeof(text_buffer), time_format, &time_context.tm);
+  }
+  
+  //the same text again would only cost a redraw
+  LineText *line_text = &line_texts[layer];
+  if(!strcmp(line_text->text, text_buffer)){
+    text_relayouts_skipped++;
+    return;
+  }
+  
+  strcpy(line_text->text, text_buffer);
+  layout_line_text(line_text);
+  redraw(layer ? ELEMENT_LINE_TWO : ELEMENT_LINE_ONE, REDRAW_TEXT);
+}
+
+static void layout_line_layer(int setting, int layer){
+  /*
+  This function sets the font and frame of either line one or line two
+  for the complication it shows. The WEEKDAY_DATE setting is too large
+  to fit, so it gets a smaller font and a frame to match
+  */
+  Layer *line_layer = layer ? line_two_layer : line_one_layer;
+  bool small = (setting == WEEKDAY_DATE);
+  
+  line_texts[layer].small = small;
+  layout_line_text(&line_texts[layer]);
+  layer_set_frame(line_layer, layout.line_frames[layer][small]);
+  redraw(layer ? ELEMENT_LINE_TWO : ELEMENT_LINE_ONE, REDRAW_LAYOUT);
+}
+
+#if defined(PBL_HEALTH)
+static void health_handler(HealthEventType event, void *context){
+  /*
+  New health data only invalidates the cache. The lines showing a
+  health metric then re-read it, so two lines showing the same metric
+  share one query, and are only rewritten past their threshold
+  */
+  if(power_saving)
+    return;
+  
+  if((event == HealthEventMovementUpdate) || (event == HealthEventSignificantUpdate)){
+    invalidate_health_values();
+    if(health_metric_for_setting(settings.line_one_setting) != NO_HEALTH_METRIC)
+      update_lines(settings.line_one_setting, 0);
+    if(health_metric_for_setting(settings.line_two_setting) != NO_HEALTH_METRIC)
+      update_lines(settings.line_two_setting, 1);
+  }
+}
+#endif
+
+static uint8_t row_pixel(GBitmapFormat format, GBitmapDataRowInfo row, int16_t x){
+  //8 bit pixels as they are, 1 bit pixels as 0 or 1 (palettized ones start from the top bit);
+  //callers look each row up once, not for every pixel
+  switch(format){
+    case GBitmapFormat1Bit:
+      return (row.data[x/8] >> (x%8)) & 1;
+    case GBitmapFormat1BitPalette:
+      return (row.data[x/8] >> (7 - x%8)) & 1;
     default:
-      strcpy(text_buffer, "error");
-    break;
+      return row.data[x];
   }
+}
+
+static void set_row_pixel(GBitmapFormat format, GBitmapDataRowInfo row, int16_t x, uint8_t value){
+  switch(format){
+    case GBitmapFormat1Bit:
+      if(value) row.data[x/8] |= 1 << (x%8);
+      else row.data[x/8] &= ~(1 << (x%8));
+      break;
+    case GBitmapFormat1BitPalette:
+      if(value) row.data[x/8] |= 0x80 >> (x%8);
+      else row.data[x/8] &= ~(0x80 >> (x%8));
+      break;
+    default:
+      row.data[x] = value;
+      break;
+  }
+}
+
+static bool in_circle(GSize size, int16_t x, int16_t y, int16_t radius){
+  //worked out in half pixels from the center of size
+  int32_t dx = 2*x - (size.w - 1), dy = 2*y - (size.h - 1);
+  return dx*dx + dy*dy <= 4*radius*radius;
+}
+
+static bool swap_sprite_pixels(GContext *ctx, Layer *layer, GBitmap *sprite, int16_t mask_radius){
+  /*
+  This function swaps the pixels under a layer with those of the sprite,
+  leaving out those further than mask_radius from the layer's center
+  when there is one, unless they were drawn on (the antialiased edge
+  on color displays). Layers are children of the root layer, so their
+  frames are in screen coordinates
+  */
+  GBitmap *frame_buffer = graphics_capture_frame_buffer(ctx);
+  if(!frame_buffer)
+    return false;
+  
+  GRect frame = layer_get_frame(layer);
+  GRect frame_bounds = gbitmap_get_bounds(frame_buffer);
+  GBitmapFormat screen_format = gbitmap_get_format(frame_buffer);
+  GBitmapFormat sprite_format = gbitmap_get_format(sprite);
+  for(int16_t y = 0; y < frame.size.h; y++){
+    int16_t screen_y = frame.origin.y + y;
+    if((screen_y < 0) || (screen_y >= frame_bounds.size.h)) continue;
+    GBitmapDataRowInfo row = gbitmap_get_data_row_info(frame_buffer, screen_y);
+    GBitmapDataRowInfo sprite_row = gbitmap_get_data_row_info(sprite, y);
+    for(int16_t x = 0; x < frame.size.w; x++){
+      int16_t screen_x = frame.origin.x + x;
+      if((screen_x < row.min_x) || (screen_x > row.max_x)) continue;
+      uint8_t screen_pixel = row_pixel(screen_format, row, screen_x);
+      set_row_pixel(screen_format, row, screen_x, row_pixel(sprite_format, sprite_row, x));
+      bool masked = mask_radius && !in_circle(frame.size, x, y, mask_radius) &&
+        PBL_IF_COLOR_ELSE(screen_pixel == background_color.argb, true);
+      set_row_pixel(sprite_format, sprite_row, x, masked ? 0 : screen_pixel);
+    }
+  }
+  graphics_release_frame_buffer(ctx, frame_buffer);
+  return true;
+}
+
+static GBitmap *sprite_begin(GContext *ctx, Layer *layer){
+  /*
+  This function starts rendering a sprite with the firmware's own
+  drawing: the pixels under the layer are kept in a new bitmap and the
+  layer is cleared to the background for the shape to be drawn on
+  */
+  GBitmap *frame_buffer = graphics_capture_frame_buffer(ctx);
+  if(!frame_buffer)
+    return NULL;
+  bool one_bit = (gbitmap_get_format(frame_buffer) == GBitmapFormat1Bit);
+  graphics_release_frame_buffer(ctx, frame_buffer);
+  
+  GRect bounds = layer_get_bounds(layer);
+  GBitmap *sprite = gbitmap_create_blank(bounds.size, one_bit ? GBitmapFormat1Bit : GBitmapFormat8Bit);
+  if(!sprite)
+    return NULL;
+  if(!swap_sprite_pixels(ctx, layer, sprite, 0)){
+    gbitmap_destroy(sprite);
+    return NULL;
+  }
+  
+  graphics_context_set_fill_color(ctx, background_color);
+  graphics_fill_rect(ctx, bounds, 0, GCornerNone);
+  return sprite;
+}
+
+static GBitmap *sprite_end(GContext *ctx, Layer *layer, GBitmap *sprite, int16_t mask_radius){
+  //the drawn shape goes into the sprite and the pixels kept by sprite_begin back on screen
+  if(!swap_sprite_pixels(ctx, layer, sprite, mask_radius)){
+    gbitmap_destroy(sprite);
+    return NULL;
+  }
+  return sprite;
+}
 
-  strcpy(layer ? text_buffer_two : text_buffer_one, text_buffer);
-  text_layer_set_text(layer ? line_two_layer : line_one_layer, layer ? text_buffer_two : text_buffer_one);
+static void draw_bt_icon(GContext *ctx){
+  GPoint center = GPoint(layout.bt_icon_radius, layout.bt_icon_radius);
+  
+  //background circle
+  graphics_context_set_fill_color(ctx, foreground_color);
+  graphics_fill_circle(ctx, center, layout.bt_icon_radius);
+  
+  //constructing bluetooth symbol
+  GPoint top_left, top_center, top_right, bottom_left, bottom_right, bottom_center;
+  top_center = GPoint(center.x, center.y - layout.bt_symbol_half_height);
+  bottom_center = GPoint(center.x, center.y + layout.bt_symbol_half_height);
+  top_left = GPoint(center.x - layout.bt_symbol_half_width, center.y - layout.bt_symbol_arm);
+  top_right = GPoint(center.x + layout.bt_symbol_half_width, center.y - layout.bt_symbol_arm);
+  bottom_left = GPoint(center.x - layout.bt_symbol_half_width, center.y + layout.bt_symbol_arm);
+  bottom_right = GPoint(center.x + layout.bt_symbol_half_width, center.y + layout.bt_symbol_arm);
+  
+  graphics_context_set_stroke_color(ctx, background_color);
+  graphics_context_set_stroke_width(ctx, 2);
+  graphics_draw_line(ctx, top_center, bottom_center);
+  graphics_draw_line(ctx, top_center, top_right);
+  graphics_draw_line(ctx, bottom_center, bottom_right);
+  graphics_draw_line(ctx, top_left, bottom_right);
+  graphics_draw_line(ctx, bottom_left, top_right);
 }
 
 static void bt_icon_update_proc(Layer *layer, GContext *ctx){
   /*
   This update proc handles the bluetooth disconnect icon. If the user
   has specified in the settings that they would like to see the icon
-  it will draw an icon on disconnect
+  it will draw an icon on disconnect. The layer is exactly the size
+  of the icon's circle. The icon is only drawn once per color scheme;
+  every redraw after that is a blit of the cached sprite
   */
-  if((!bt_connected) && (bluetooth_icon_bool)){
-    GRect bounds = layer_get_unobstructed_bounds(layer);
-    GPoint center = GPoint(bounds.size.w/2, bounds.size.h/2);
-    
-    //background circle
-    graphics_context_set_fill_color(ctx, foreground_color);
-    graphics_fill_circle(ctx, center, bounds.size.w/6 - gap_width);
+  uint32_t draw_started = telemetry_draw_begin();
+  accounting_stack_begin();
+  
+  if((!bt_connected) && (settings.bluetooth_icon)){
+    GRect bounds = layer_get_bounds(layer);
+    int16_t mask_radius = layout.bt_icon_radius;
     
-    //constructing bluetooth symbol
-    GPoint top_left, top_center, top_right, bottom_left, bottom_right, bottom_center;
-    uint8_t symbol_width = bounds.size.w * 0.06;
-    top_center = GPoint(center.x, center.y - bounds.size.w/8);
-    bottom_center = GPoint(center.x, center.y + bounds.size.w/8);
-    top_left = GPoint(center.x - symbol_width, center.y - bounds.size.w/16);
-    top_right = GPoint(center.x + symbol_width, center.y - bounds.size.w/16);
-    bottom_left = GPoint(center.x - symbol_width, center.y + bounds.size.w/16);
-    bottom_right = GPoint(center.x + symbol_width, center.y + bounds.size.w/16);
+    //a sprite drawn for another layout is drawn again
+    if(bt_icon_sprite){
+      GRect sprite_bounds = gbitmap_get_bounds(bt_icon_sprite);
+      if(!gsize_equal(&sprite_bounds.size, &bounds.size))
+        invalidate_sprites();
+    }
+    if(!bt_icon_sprite){
+      bt_icon_sprite = sprite_begin(ctx, layer);
+      if(bt_icon_sprite){
+        draw_bt_icon(ctx);
+        bt_icon_sprite = sprite_end(ctx, layer, bt_icon_sprite, mask_radius);
+      }
+    }
+#if defined(PBL_BW)
+    if(!bt_icon_mask){
+      bt_icon_mask = gbitmap_create_blank(bounds.size, GBitmapFormat1Bit);
+      for(int16_t y = 0; bt_icon_mask && (y < bounds.size.h); y++){
+        GBitmapDataRowInfo row = gbitmap_get_data_row_info(bt_icon_mask, y);
+        for(int16_t x = 0; x < bounds.size.w; x++)
+          set_row_pixel(GBitmapFormat1Bit, row, x, in_circle(bounds.size, x, y, mask_radius));
+      }
+    }
+#endif
     
-    graphics_context_set_stroke_color(ctx, background_color);
-    graphics_context_set_stroke_width(ctx, 2);
-    graphics_draw_line(ctx, top_center, bottom_center);
-    graphics_draw_line(ctx, top_center, top_right);
-    graphics_draw_line(ctx, bottom_center, bottom_right);
-    graphics_draw_line(ctx, top_left, bottom_right);
-    graphics_draw_line(ctx, bottom_left, top_right);
+    if(!bt_icon_sprite){
+      draw_bt_icon(ctx);
+    }
+    else{
+#if defined(PBL_BW)
+      if(bt_icon_mask){
+        graphics_context_set_compositing_mode(ctx, GCompOpClear);
+        graphics_draw_bitmap_in_rect(ctx, bt_icon_mask, bounds);
+      }
+      graphics_context_set_compositing_mode(ctx, GCompOpOr);
+#else
+      graphics_context_set_compositing_mode(ctx, GCompOpSet);
+#endif
+      graphics_draw_bitmap_in_rect(ctx, bt_icon_sprite, bounds);
+      graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+    }
   }
+  
+  accounting_stack_end(STACK_BT_ICON);
+  telemetry_draw_end(TELEMETRY_BT_ICON, draw_started);
+}
+
+static void draw_center_bar(GContext *ctx, GPoint center, int half_bar_length){
+  GPoint left_point =  GPoint(center.x - half_bar_length, center.y);
+  GPoint right_point = GPoint(center.x + half_bar_length, center.y);
+  
+  graphics_context_set_stroke_color(ctx, foreground_color);
+  graphics_draw_line(ctx, left_point, right_point);
 }
 
 static void battery_update_proc(Layer *layer, GContext *ctx){
   /*
   This update draws the center line dependent on the user's
-  choice, based on the global variable center_line_setting
+  choice, based on settings.center_line_setting.
+  The layer only spans the longest possible line
   */
-  GRect bounds = layer_get_bounds(layer);
-  GPoint center = GPoint(bounds.size.w/2, bounds.size.h/2);
+  uint32_t draw_started = telemetry_draw_begin();
+  accounting_stack_begin();
+  GPoint center = GPoint(layout.center_bar_half_length, 0);
   int half_bar_length = 0;
   bool draw_line;
   
-  switch(center_line_setting){
+  switch(settings.center_line_setting){
     case BATTERY: 
-      half_bar_length = bounds.size.w/6 * (battery_level / 100.0);
+      half_bar_length = layout.center_bar_half_length * battery_level / 100;
       draw_line = true;
     break;
     case CONSTANT: 
-      half_bar_length = bounds.size.w/6;  
+      half_bar_length = layout.center_bar_half_length;
       draw_line = true;
     break;
     case NONE:
@@ -280,259 +1438,782 @@ static void battery_update_proc(Layer *layer, GContext *ctx){
   }
   
   if(draw_line){
-    GPoint left_point =  GPoint(center.x - half_bar_length, center.y);
-    GPoint right_point = GPoint(center.x + half_bar_length, center.y);
+    //the full length bar is drawn once per color scheme, and cut to length from then on
+    if(!center_bar_sprite){
+      center_bar_sprite = sprite_begin(ctx, layer);
+      if(center_bar_sprite){
+        draw_center_bar(ctx, center, layout.center_bar_half_length);
+        center_bar_sprite = sprite_end(ctx, layer, center_bar_sprite, 0);
+      }
+    }
+    
+    if(center_bar_sprite){
+      graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+      graphics_draw_bitmap_in_rect(ctx, center_bar_sprite,
+                                   GRect(center.x - half_bar_length, center.y, 2*half_bar_length + 1, 1));
+    }
+    else{
+      draw_center_bar(ctx, center, half_bar_length);
+    }
+  }
+  
+  accounting_stack_end(STACK_BATTERY);
+  telemetry_draw_end(TELEMETRY_BATTERY, draw_started);
+}
+
+static void cover_arc_end(GContext *ctx, GRect bounds, int32_t end){
+  /*
+  This function fills the last ring_overlap_angle of a restored minute
+  or hour ring again before the wedge that continues it is added, so
+  its antialiased end does not stay behind as a seam. Only the inside
+  of the ring is filled: the edge pixels along its circles are already
+  blended, and graphics_fill_radial would blend them a second time
+  */
+  int32_t start = (end > ring_overlap_angle) ? end - ring_overlap_angle : 0;
+  if((end > start) && (layout.ring_thickness > 2))
+    graphics_fill_radial(ctx, grect_inset(bounds, GEdgeInsets(1)), GOvalScaleModeFitCircle,
+                         layout.ring_thickness - 2, start, end);
+}
+
+static void fill_seconds_ring(GContext *ctx, GRect outer_bounds, int32_t minute_angle, int32_t start, int32_t end){
+  /*
+  This function fills part of the seconds ring, which runs along the
+  outer edge of the minute ring: cut into the minute ring where that is
+  filled, and drawn over the background where it is not
+  */
+  GRect bounds = grect_inset(outer_bounds, GEdgeInsets(layout.seconds_ring_inset));
+  int32_t split = (minute_angle < start) ? start : ((minute_angle > end) ? end : minute_angle);
+  
+  if(split > start){
+    graphics_context_set_fill_color(ctx, background_color);
+    graphics_fill_radial(ctx, bounds, GOvalScaleModeFitCircle, layout.seconds_ring_thickness, start, split);
+  }
+  if(end > split){
+    graphics_context_set_fill_color(ctx, foreground_color);
+    graphics_fill_radial(ctx, bounds, GOvalScaleModeFitCircle, layout.seconds_ring_thickness, split, end);
+  }
+}
+
+static GRect ring_bounds(Layer *layer){
+  /*
+  This function returns the bounds the rings are fitted to. While Quick
+  View animates they keep the size they have at the obstructed end and
+  only follow the center of the unobstructed area, so the frames in
+  between can move the cached rings instead of drawing new ones
+  */
+  GRect unobstructed_bounds = layer_get_unobstructed_bounds(layer);
+  if(!ring_transition)
+    return unobstructed_bounds;
+  
+  GRect bounds = transition_bounds;
+  bounds.origin.y = unobstructed_bounds.origin.y + (unobstructed_bounds.size.h - bounds.size.h)/2;
+  return bounds;
+}
+
+static void fill_ring(GContext *ctx, int ring, GRect bounds, int32_t angle_start, int32_t angle_end){
+  /*
+  This function fills part of the minute (0) or hour (1) ring. With
+  span_rings set it writes 8 bit framebuffers directly from the ring's
+  span table, which works in screen coordinates, as the ring layer
+  covers the whole window. Everything else goes to graphics_fill_radial
+  */
+  if(span_rings){
+    GBitmap *frame_buffer = graphics_capture_frame_buffer(ctx);
+    if(frame_buffer){
+      bool filled = (gbitmap_get_format(frame_buffer) != GBitmapFormat1Bit) &&
+        ring_spans_build(&ring_spans[ring], bounds.size, layout.ring_thickness);
+      if(filled)
+        ring_spans_fill(&ring_spans[ring], frame_buffer, bounds.origin, foreground_color, background_color,
+                        !power_saving, angle_start, angle_end);
+      graphics_release_frame_buffer(ctx, frame_buffer);
+      if(filled) return;
+    }
+  }
+  graphics_fill_radial(ctx, bounds, GOvalScaleModeFitCircle, layout.ring_thickness, angle_start, angle_end);
+}
+
+static GBitmap *glyph_atlas_render(GContext *ctx, Layer *layer, GlyphAtlas *atlas, GFont font){
+  /*
+  This function draws every glyph of a font once, in batches as wide as
+  the layer, and reads each back as 1 bit ink: whatever differs from
+  the background. The pixels under the layer are put back afterwards.
+  Color atlases are palettized, so a new foreground color is only a
+  change of palette
+  */
+  GRect bounds = layer_get_bounds(layer);
+  GRect frame = layer_get_frame(layer);
+  int16_t height = (atlas->height < bounds.size.h) ? atlas->height : bounds.size.h;
+  GSize size = GSize(atlas->x[num_line_glyphs - 1] + atlas->advance[num_line_glyphs - 1] + 2*glyph_margin, height);
+  
+#if defined(PBL_COLOR)
+  GColor *palette = malloc(2*sizeof(GColor));
+  if(!palette)
+    return NULL;
+  palette[0] = GColorClear;
+  palette[1] = foreground_color;
+  GBitmap *bitmap = gbitmap_create_blank_with_palette(size, GBitmapFormat1BitPalette, palette, true);
+  if(!bitmap){
+    free(palette);
+    return NULL;
+  }
+#else
+  GBitmap *bitmap = gbitmap_create_blank(size, GBitmapFormat1Bit);
+  if(!bitmap)
+    return NULL;
+#endif
+  
+  GBitmap *saved = sprite_begin(ctx, layer);
+  if(!saved){
+    gbitmap_destroy(bitmap);
+    return NULL;
+  }
+  
+  uint8_t background = PBL_IF_COLOR_ELSE(background_color.argb, gcolor_equal(background_color, GColorWhite));
+  char glyph_text[2] = "";
+  graphics_context_set_text_color(ctx, foreground_color);
+  graphics_context_set_fill_color(ctx, background_color);
+  for(unsigned int first = 0, last; first < num_line_glyphs; first = last){
+    //as many glyphs as fit side by side, each in its own cell
+    int16_t x = 0;
+    for(last = first; last < num_line_glyphs; last++){
+      int16_t cell_width = atlas->advance[last] + 2*glyph_margin;
+      if((last > first) && (x + cell_width > bounds.size.w)) break;
+      glyph_text[0] = line_glyphs[last];
+      graphics_draw_text(ctx, glyph_text, font, GRect(x + glyph_margin, 0, cell_width - glyph_margin, height),
+                         GTextOverflowModeWordWrap, GTextAlignmentLeft, NULL);
+      x += cell_width;
+    }
+    
+    GBitmap *frame_buffer = graphics_capture_frame_buffer(ctx);
+    if(frame_buffer){
+      GRect frame_bounds = gbitmap_get_bounds(frame_buffer);
+      GBitmapFormat screen_format = gbitmap_get_format(frame_buffer);
+      GBitmapFormat atlas_format = gbitmap_get_format(bitmap);
+      for(int16_t y = 0; y < height; y++){
+        int16_t screen_y = frame.origin.y + y;
+        if((screen_y < 0) || (screen_y >= frame_bounds.size.h)) continue;
+        GBitmapDataRowInfo row = gbitmap_get_data_row_info(frame_buffer, screen_y);
+        GBitmapDataRowInfo atlas_row = gbitmap_get_data_row_info(bitmap, y);
+        x = 0;
+        for(unsigned int glyph = first; glyph < last; glyph++){
+          int16_t cell_width = atlas->advance[glyph] + 2*glyph_margin;
+          for(int16_t cell_x = 0; cell_x < cell_width; cell_x++){
+            int16_t screen_x = frame.origin.x + x + cell_x;
+            bool ink = (screen_x >= row.min_x) && (screen_x <= row.max_x) &&
+              (row_pixel(screen_format, row, screen_x) != background);
+            set_row_pixel(atlas_format, atlas_row, atlas->x[glyph] + cell_x, ink);
+          }
+          x += cell_width;
+        }
+      }
+      graphics_release_frame_buffer(ctx, frame_buffer);
+    }
+    graphics_fill_rect(ctx, bounds, 0, GCornerNone);
+  }
+  
+  swap_sprite_pixels(ctx, layer, saved, 0);
+  gbitmap_destroy(saved);
+  return bitmap;
+}
+
+static void line_update_proc(Layer *layer, GContext *ctx){
+  /*
+  This update proc draws complication line one or two by blitting the
+  cell of each character from the atlas of its font, centered. Text
+  with a character the atlas lacks, or too wide for the line, is drawn
+  as text instead
+  */
+  int line = (layer == line_two_layer);
+  LineText *line_text = &line_texts[line];
+  GlyphAtlas *atlas = &glyph_atlases[line_text->small];
+  GFont font = fonts_get_system_font(layout.line_fonts[line_text->small]);
+  GRect bounds = layer_get_bounds(layer);
+  uint32_t draw_started = telemetry_draw_begin();
+  accounting_stack_begin();
   
-    graphics_context_set_stroke_color(ctx, foreground_color);
-    graphics_draw_line(ctx, left_point, right_point);
+  int16_t width = line_text_width(line_text);
+  bool blit = (width >= 0) && (width <= bounds.size.w);
+  if(blit && !atlas->bitmap)
+    atlas->bitmap = glyph_atlas_render(ctx, layer, atlas, font);
+  if(!blit || !atlas->bitmap){
+    graphics_context_set_text_color(ctx, foreground_color);
+    graphics_draw_text(ctx, line_text->text, font, bounds, GTextOverflowModeWordWrap, GTextAlignmentCenter, NULL);
   }
+  else{
+#if defined(PBL_COLOR)
+    gbitmap_get_palette(atlas->bitmap)[1] = foreground_color;
+    graphics_context_set_compositing_mode(ctx, GCompOpSet);
+#else
+    //1 bit bitmaps have no transparency, so the ink sets or clears pixels
+    graphics_context_set_compositing_mode(ctx, gcolor_equal(foreground_color, GColorWhite) ? GCompOpSet : GCompOpClear);
+#endif
+    int16_t height = gbitmap_get_bounds(atlas->bitmap).size.h;
+    int16_t x = (bounds.size.w - width)/2;
+    for(int i = 0; i < line_text->length; i++){
+      uint8_t glyph = line_text->glyphs[i];
+      int16_t cell_width = atlas->advance[glyph] + 2*glyph_margin;
+      gbitmap_set_bounds(atlas->bitmap, GRect(atlas->x[glyph], 0, cell_width, height));
+      graphics_draw_bitmap_in_rect(ctx, atlas->bitmap, GRect(x - glyph_margin, 0, cell_width, height));
+      x += atlas->advance[glyph];
+    }
+    graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+  }
+  
+  accounting_stack_end(STACK_LINE);
+  telemetry_draw_end(TELEMETRY_LINE_ONE + line, draw_started);
 }
 
+static void cold_start_refresh(void *data);
+
 static void ring_update_proc(Layer *layer, GContext *ctx){
   /*
-  This update proc draws the rings which show the time
+  This update proc draws the rings which show the time. When the last
+  drawn rings are still cached and only grew since, the cached frame is
+  restored and just the newly covered wedge of each ring is filled.
+  The seconds ring is treated as a third ring, so its frames only fill
+  the seconds covered since the frame before. During Quick View
+  transitions the cached rings are moved instead of drawn again
   */
-  GRect outer_bounds = layer_get_unobstructed_bounds(layer);
-  GRect inner_bounds = grect_inset(outer_bounds, GEdgeInsets(outer_bounds.size.w/6));
+  uint32_t draw_started = telemetry_draw_begin();
+  accounting_stack_begin();
+  GRect outer_bounds = ring_bounds(layer);
+  GRect inner_bounds = grect_inset(outer_bounds, GEdgeInsets(layout.ring_inset));
   
-  time_t now = time(NULL);
-  struct tm *t = localtime(&now);
+  //the rings show the minute of the last tick, whatever caused this redraw
+  int32_t minute_angle = time_context.minute_angle;
+  int32_t hour_angle = time_context.hour_angle;
+  
+  //the seconds ring moves in whole frames; time zones are whole minutes, so the seconds need no localtime
+  int32_t seconds_angle = 0;
+  if(seconds_ring_running){
+    time_t now;
+    uint16_t milliseconds = time_ms(&now, NULL);
+    int frame = (now % 60)*seconds_ring_fps + milliseconds*seconds_ring_fps/1000;
+    seconds_angle = TRIG_MAX_ANGLE * frame / (60*seconds_ring_fps);
+  }
   
-  int minute = t->tm_min;
-  int hour = t->tm_hour;
+  //the rings only move during a transition, the time they show catches up once it is over
+  if(ring_transition && ring_cache_valid){
+    minute_angle = cached_minute_angle;
+    hour_angle = cached_hour_angle;
+  }
   
-  //corrects for 12 hour format
-  if(hour >= 12) hour -= 12;
+  //rows of the cache can be moved up and down on rectangular displays only
+  int16_t shift = outer_bounds.origin.y - cached_ring_bounds.origin.y;
+  bool same_rows = (shift == 0) || (ring_transition && PBL_IF_RECT_ELSE(true, false));
   
-  int minute_angle = 360 * (minute / 60.0);
-  //int hour_angle = 360 * ((hour / 12.0) + (0.1 * (minute / 60.0)));
-  int hour_angle = 360 * (( hour + (minute / 60.0)) / 12.0); //better algorithm
+  //the cached frame is only usable if nothing but the time has moved forward since
+  bool incremental = incremental_rings && ring_cache_valid && same_rows &&
+    (outer_bounds.origin.x == cached_ring_bounds.origin.x) &&
+    gsize_equal(&outer_bounds.size, &cached_ring_bounds.size) &&
+    gcolor_equal(background_color, cached_background_color) &&
+    gcolor_equal(foreground_color, cached_foreground_color) &&
+    (minute_angle >= cached_minute_angle) && (hour_angle >= cached_hour_angle) &&
+    (seconds_angle >= cached_seconds_angle);
   
-  //to handle random color switches on the hour
-  if((color_setting != 0) && (minute == 59))
-    update_colors();
+  int32_t minute_start = 0, hour_start = 0, seconds_start = 0;
+  bool rings_changed = true, restored = false;
+  if(incremental){
+    GBitmap *frame_buffer = graphics_capture_frame_buffer(ctx);
+    if(frame_buffer){
+      ring_cache_copy(frame_buffer, outer_bounds, false, shift);
+      graphics_release_frame_buffer(ctx, frame_buffer);
+      
+      //a ring that has moved is continued from its old end, one that has not is left as restored
+      minute_start = cached_minute_angle;
+      hour_start = cached_hour_angle;
+      seconds_start = cached_seconds_angle;
+      restored = true;
+      
+      //redraws for the battery line or bluetooth icon end here, the rings are already restored
+      rings_changed = (minute_angle != cached_minute_angle) || (hour_angle != cached_hour_angle) ||
+        (seconds_angle != cached_seconds_angle);
+    }
+  }
   
-  graphics_context_set_antialiased(ctx, true);
+  //the simplified rings drawn while saving power skip antialiasing
+  graphics_context_set_antialiased(ctx, !power_saving);
   graphics_context_set_fill_color(ctx, foreground_color);
   
-  graphics_fill_radial(ctx, outer_bounds, GOvalScaleModeFitCircle, outer_bounds.size.w/6 - gap_width,
-                       DEG_TO_TRIGANGLE(0), DEG_TO_TRIGANGLE(minute_angle));
-  graphics_fill_radial(ctx, inner_bounds, GOvalScaleModeFitCircle, outer_bounds.size.w/6 - gap_width,
-                       DEG_TO_TRIGANGLE(0), DEG_TO_TRIGANGLE(hour_angle));
-    
+  //span fills end sharply, and nothing is antialiased on black and white screens or while saving power
+  bool cover_ends = restored && !power_saving && !span_rings && PBL_IF_COLOR_ELSE(true, false);
+  if(cover_ends && (minute_angle > minute_start))
+    cover_arc_end(ctx, outer_bounds, minute_start);
+  if(cover_ends && (hour_angle > hour_start))
+    cover_arc_end(ctx, inner_bounds, hour_start);
+  
+  if(rings_changed && (minute_angle > minute_start))
+    fill_ring(ctx, 0, outer_bounds, minute_start, minute_angle);
+  if(rings_changed && (hour_angle > hour_start))
+    fill_ring(ctx, 1, inner_bounds, hour_start, hour_angle);
+  if(rings_changed && (seconds_angle > seconds_start))
+    fill_seconds_ring(ctx, outer_bounds, minute_angle, seconds_start, seconds_angle);
+  
+  //keep this frame around so the next minute only has to add its wedge
+  if(incremental_rings && rings_changed){
+    GBitmap *frame_buffer = graphics_capture_frame_buffer(ctx);
+    if(frame_buffer && ring_cache_alloc(frame_buffer)){
+      ring_cache_copy(frame_buffer, outer_bounds, true, 0);
+      ring_cache_valid = true;
+      cached_minute_angle = minute_angle;
+      cached_hour_angle = hour_angle;
+      cached_seconds_angle = seconds_angle;
+      cached_ring_bounds = outer_bounds;
+      cached_background_color = background_color;
+      cached_foreground_color = foreground_color;
+    }
+    if(frame_buffer) graphics_release_frame_buffer(ctx, frame_buffer);
+  }
+  
+  //the services are only asked once the first frame after a load from the snapshot is out
+  if(cold_start_pending){
+    cold_start_pending = false;
+    cold_start_timer = app_timer_register(0, cold_start_refresh, NULL);
+  }
+  
+  accounting_stack_end(STACK_RING);
+  telemetry_draw_end(TELEMETRY_RING, draw_started);
+}
+
+static void seconds_ring_frame(void *data);
+
+static void seconds_ring_schedule(void){
+  //frames land on whole fractions of a second, seconds_ring_fps of them each second
+  uint16_t frame_ms = 1000 / seconds_ring_fps;
+  seconds_timer = app_timer_register(frame_ms - time_ms(NULL, NULL) % frame_ms, seconds_ring_frame, NULL);
+}
+
+static void seconds_ring_stop(void){
+  if(!seconds_ring_running)
+    return;
+  seconds_ring_running = false;
+  if(seconds_timer)
+    app_timer_cancel(seconds_timer);
+  seconds_timer = NULL;
+  
+  //one more frame takes the ring away, redrawing the other rings in full
+  redraw(ELEMENT_RING, REDRAW_SECONDS);
+}
+
+static void seconds_ring_frame(void *data){
+  /*
+  This timer callback schedules the seconds ring's frames. A frame only
+  marks the ring layer dirty; ring_update_proc then restores the cached
+  rings and fills just the seconds covered since the last frame
+  */
+  seconds_timer = NULL;
+  if((int32_t)(clock_ms() - seconds_ring_until) >= 0){
+    seconds_ring_stop();
+    return;
+  }
+  redraw(ELEMENT_RING, REDRAW_SECONDS);
+  seconds_ring_schedule();
+}
+
+static void seconds_ring_start(void){
+  /*
+  This function shows the seconds ring for seconds_ring_duration seconds,
+  or extends it when it is already running. It stays off while saving
+  power and while the screen is obstructed or Quick View animates
+  */
+  if((!settings.seconds_ring) || (power_saving) || (obstructed) || (ring_transition))
+    return;
+  
+  seconds_ring_until = clock_ms() + seconds_ring_duration*1000;
+  if(seconds_ring_running)
+    return;
+  seconds_ring_running = true;
+  redraw(ELEMENT_RING, REDRAW_SECONDS);
+  seconds_ring_schedule();
+}
+
+static void reveal_lines_show(bool shown){
+  //the lines are brought up to date as they come back, after being left alone while hidden
+  shown = shown && (!obstructed);
+  if(shown && layer_get_hidden(line_one_layer)){
+    update_lines(settings.line_one_setting, 0);
+    update_lines(settings.line_two_setting, 1);
+  }
+  layer_set_hidden(line_one_layer, !shown);
+  layer_set_hidden(line_two_layer, !shown);
+}
+
+static void reveal_lines_end(void *data){
+  reveal_timer = NULL;
+  lines_revealed = false;
+  reveal_lines_show(lines_shown());
+}
+
+static void reveal_lines_start(void){
+  /*
+  This function shows the lines for reveal_duration seconds, or keeps
+  them up longer when they are already shown. Only then are they
+  formatted, and their health values read
+  */
+  if(!settings.reveal_lines)
+    return;
+  
+  if(reveal_timer)
+    app_timer_reschedule(reveal_timer, reveal_duration*1000);
+  else
+    reveal_timer = app_timer_register(reveal_duration*1000, reveal_lines_end, NULL);
+  
+  if(lines_revealed)
+    return;
+  lines_revealed = true;
+  reveal_lines_show(true);
+}
+
+static void reveal_lines_enable(bool enable){
+  //turning the option off shows the lines for good
+  if(reveal_timer)
+    app_timer_cancel(reveal_timer);
+  reveal_timer = NULL;
+  lines_revealed = false;
+  if(enable)
+    reveal_lines_show(lines_shown());
+}
+
+static void accel_tap_handler(AccelAxisType axis, int32_t direction){
+  seconds_ring_start();
+  reveal_lines_start();
+}
+
+static void accel_tap_enable(bool enable){
+  //the accelerometer is only listened to while the seconds ring or revealing the lines is turned on
+  if(!enable || !settings.seconds_ring)
+    seconds_ring_stop();
+  if(enable && (settings.seconds_ring || settings.reveal_lines))
+    accel_tap_service_subscribe(accel_tap_handler);
+  else
+    accel_tap_service_unsubscribe();
+}
+
+static bool in_quiet_hours(int hour){
+  //quiet hours may wrap past midnight, equal start and end hours mean none
+  if(settings.quiet_start == settings.quiet_end)
+    return false;
+  if(settings.quiet_start < settings.quiet_end)
+    return (hour >= settings.quiet_start) && (hour < settings.quiet_end);
+  return (hour >= settings.quiet_start) || (hour < settings.quiet_end);
+}
+
+static bool power_save_wanted(struct tm *t){
+  /*
+  This function decides whether the face should save power: while the
+  battery is low, during the configured quiet hours, or while the user
+  is asleep. Never while charging
+  */
+  if(battery_charging)
+    return false;
+  if((settings.power_save_battery) && (battery_level <= settings.power_save_battery))
+    return true;
+  if((settings.quiet_hours) && in_quiet_hours(t->tm_hour))
+    return true;
+#if defined(PBL_HEALTH)
+  if(health_service_peek_current_activities() & (HealthActivitySleep | HealthActivityRestfulSleep))
+    return true;
+#endif
+  return false;
+}
+
+static void set_power_saving(bool saving){
+  /*
+  This function switches between normal and power saving mode. While
+  saving power the rings are redrawn every power_save_interval minutes
+  without antialiasing, colors do not rotate and the complications are
+  only updated on those ticks. Leaving the mode brings everything up
+  to date at once
+  */
+  if(saving == power_saving)
+    return;
+  power_saving = saving;
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "power saving %s", saving ? "on" : "off");
+  
+  if(saving)
+    seconds_ring_stop();
+  
+  invalidate_ring_cache();
+  redraw(ELEMENT_RING, REDRAW_POWER_SAVING);
+  
+  if(!saving){
+    invalidate_health_values();
+    line_health_valid[0] = false;
+    line_health_valid[1] = false;
+    update_lines(settings.line_one_setting, 0);
+    update_lines(settings.line_two_setting, 1);
+  }
+}
+
+static void update_power_saving(void){
+  set_power_saving(power_save_wanted(&time_context.tm));
 }
 
 static void battery_callback(BatteryChargeState state){
   battery_level = state.charge_percent;  //update global variable
-  layer_mark_dirty(battery_layer);
+  battery_charging = state.is_charging || state.is_plugged;
+  redraw(ELEMENT_BATTERY, REDRAW_BATTERY);
+  update_power_saving();
 }
 
 static void bluetooth_callback(bool connected){
-  if((!connected) && (bluetooth_vibes_bool)){
+  if((!connected) && (settings.bluetooth_vibes)){
     vibes_double_pulse();
   }
   bt_connected = connected;  //update global variable
-  layer_mark_dirty(bt_icon_layer);
+  bt_reported = connected;
+  redraw(ELEMENT_BT_ICON, REDRAW_CONNECTION);
+}
+
+static void bluetooth_settle(void *data){
+  //the change lasted, so it is shown
+  bt_debounce_timer = NULL;
+  if(bt_reported != bt_connected)
+    bluetooth_callback(bt_reported);
+}
+
+static void bluetooth_handler(bool connected){
+  /*
+  This function debounces the connection service. A change is only
+  shown, and vibrated for, once it has lasted bt_debounce_interval
+  seconds; one undone before then, like the drops of a phone in an
+  elevator, is only counted
+  */
+  bt_reported = connected;
+  
+  if(connected != bt_connected){
+    if(!bt_debounce_timer)
+      bt_debounce_timer = app_timer_register(bt_debounce_interval*1000, bluetooth_settle, NULL);
+    return;
+  }
+  
+  //back to what is shown
+  if(!bt_debounce_timer)
+    return;
+  app_timer_cancel(bt_debounce_timer);
+  bt_debounce_timer = NULL;
+  
+  bool vibe_saved = connected && settings.bluetooth_vibes;  //the undone change was a disconnect
+  bt_flaps++;
+  if(vibe_saved) bt_vibes_saved++;
+  TelemetrySlot *slot = telemetry_current();
+  if(slot){
+    telemetry_add(&slot->bt_flaps, 1);
+    if(vibe_saved) telemetry_add(&slot->bt_vibes_saved, 1);
+  }
+}
+
+static bool cadence_crossed(int setting){
+  /*
+  This function decides whether the last tick crossed the boundary at
+  which the complication selected by setting can show something new
+  */
+  TimeUnits units_changed = time_context.crossed;
+  if((setting < 0) || (setting >= num_complications))
+    return true;
+  
+  switch(complication_providers[setting].cadence){
+    case CADENCE_MINUTE:
+      return units_changed & MINUTE_UNIT;
+    case CADENCE_DAY:
+      return units_changed & DAY_UNIT;
+    case CADENCE_HEALTH:
+      //without health events these are polled every minute
+      return (!health_events_subscribed) || (units_changed & DAY_UNIT);
+    default:
+      return true;
+  }
 }
 
 static void tick_handler(struct tm *tick_time, TimeUnits units_changed){
-  //update complications
-  update_lines(line_one_setting, 0);
-  update_lines(line_two_setting, 1);
+  accounting_checkpoint(HEAP_STEADY);
+  
+  //everything shows this tick's time until the next one
+  time_context_set(tick_time, units_changed);
+  
+  //telemetry is kept per hour
+  if(units_changed & HOUR_UNIT)
+    telemetry_next_slot();
+  
+  //while saving power only every power_save_interval-th minute is drawn
+  set_power_saving(power_save_wanted(tick_time));
+  if((power_saving) && (!(units_changed & DAY_UNIT)) && (tick_time->tm_min % power_save_interval))
+    return;
+  
+  //random palettes change on the hour, but stay put while saving power
+  if((units_changed & HOUR_UNIT) && (!power_saving))
+    rotate_colors();
+  
+  //without health events the cache is refreshed every minute, and always at midnight
+  if((!health_events_subscribed) || (units_changed & DAY_UNIT))
+    invalidate_health_values();
+  
+  //update only the complications that can have changed
+  if(cadence_crossed(settings.line_one_setting))
+    update_lines(settings.line_one_setting, 0);
+  if(cadence_crossed(settings.line_two_setting))
+    update_lines(settings.line_two_setting, 1);
   
   //redraw time
-  layer_mark_dirty(ring_layer);
+  redraw(ELEMENT_RING, REDRAW_TIME);
+}
+
+static int32_t tuple_int(const Tuple *tuple){
+  //settings come as single bytes, but any integer width is read
+  if(tuple->type == TUPLE_BYTE_ARRAY)
+    return tuple->length ? tuple->value->uint8 : -1;  //the first byte
+  if(tuple->type == TUPLE_CSTRING)
+    return -1;
+  switch(tuple->length){
+    case 1: return (tuple->type == TUPLE_INT) ? tuple->value->int8 : tuple->value->uint8;
+    case 2: return (tuple->type == TUPLE_INT) ? tuple->value->int16 : tuple->value->uint16;
+    default: return tuple->value->int32;
+  }
+}
+
+static void apply_setting(Settings *updated, uint32_t key, int32_t value){
+  /*
+  This function stores one coded setting from the configuration page.
+  Values out of range, such as a health complication on a watch without
+  health, leave the setting as it was
+  */
+  if(value < 0)
+    return;
+  
+  if((key == MESSAGE_KEY_colorSetting) && (value < num_color_settings))
+    updated->color_setting = value;
+  else if(key == MESSAGE_KEY_backgroundColor)
+    updated->bg_color = (GColor){ .argb = value | 0xC0 };  //colors are sent as GColor8, opaque
+  else if(key == MESSAGE_KEY_foregroundColor)
+    updated->fg_color = (GColor){ .argb = value | 0xC0 };
+  else if((key == MESSAGE_KEY_topLineSetting) && (value < num_complications))
+    updated->line_one_setting = value;
+  else if((key == MESSAGE_KEY_bottomLineSetting) && (value < num_complications))
+    updated->line_two_setting = value;
+  else if((key == MESSAGE_KEY_centerLineSetting) && (value < num_center_line_settings))
+    updated->center_line_setting = value;
+  else if(key == MESSAGE_KEY_bluetoothVibes)
+    updated->bluetooth_vibes = value;
+  else if(key == MESSAGE_KEY_bluetoothIcon)
+    updated->bluetooth_icon = value;
+  else if((key == MESSAGE_KEY_powerSaveBattery) && (value <= 100))
+    updated->power_save_battery = value;
+  else if(key == MESSAGE_KEY_quietHours)
+    updated->quiet_hours = value;
+  else if((key == MESSAGE_KEY_quietStart) && (value < 24))
+    updated->quiet_start = value;
+  else if((key == MESSAGE_KEY_quietEnd) && (value < 24))
+    updated->quiet_end = value;
+  else if(key == MESSAGE_KEY_telemetry)
+    updated->telemetry = value;
+  else if(key == MESSAGE_KEY_secondsRing)
+    updated->seconds_ring = value;
+  else if(key == MESSAGE_KEY_revealLines)
+    updated->reveal_lines = value;
 }
 
 static void inbox_received_handler(DictionaryIterator *iter, void *context){
-  //Tuples pull the values from the settings page
-  Tuple *color_setting_t = dict_find(iter, MESSAGE_KEY_colorSetting);
-  Tuple *background_color_t = dict_find(iter, MESSAGE_KEY_backgroundColor);
-  Tuple *foreground_color_t = dict_find(iter, MESSAGE_KEY_foregroundColor);
-  Tuple *top_line_t = dict_find(iter, MESSAGE_KEY_topLineSetting);
-  Tuple *bottom_line_t = dict_find(iter, MESSAGE_KEY_bottomLineSetting);
-  Tuple *center_line_t = dict_find(iter, MESSAGE_KEY_centerLineSetting);
-  Tuple *bluetooth_vibes_t = dict_find(iter, MESSAGE_KEY_bluetoothVibes);
-  Tuple *bluetooth_icon_t = dict_find(iter, MESSAGE_KEY_bluetoothIcon);
-  
-  if(color_setting_t){
-    char *buffer = color_setting_t->value->cstring;  //The value returned from the settings page is a cstring
-    
-    //The cstring is immediately converted to an integer
-    if(!strcmp(buffer, "selectedColors"))
-      color_setting = SELECTED_COLORS;
-    else if(!strcmp(buffer, "trueRandom"))
-       color_setting = TRUE_RANDOM;
-    else if(!strcmp(buffer, "dark"))
-       color_setting = DARK;
-    else if(!strcmp(buffer, "light"))
-       color_setting = LIGHT;
-    else if(!strcmp(buffer, "hot"))
-       color_setting = HOT;
-    else if(!strcmp(buffer, "cold"))
-       color_setting = COLD;
-       
-    persist_write_int(MESSAGE_KEY_colorSetting, color_setting);
-    update_colors();
-    layer_mark_dirty(ring_layer);
-  }
-  if(background_color_t){
-    int background_color_HEX = background_color_t->value->int32;   //The value returned is an integer
-    persist_write_int(MESSAGE_KEY_backgroundColor, background_color_HEX);
-    bg_color_settings = GColorFromHEX(background_color_HEX);      //converted to a GColor and stored in a global variable
-    update_colors();
-    layer_mark_dirty(ring_layer);
-  }
-  if(foreground_color_t){
-    int foreground_color_HEX = foreground_color_t->value->int32;  //The value returned is an integer
-    persist_write_int(MESSAGE_KEY_foregroundColor, foreground_color_HEX);
-    fg_color_settings = GColorFromHEX(foreground_color_HEX);      //converted to a GColor and stored in a global veriable
-    update_colors();
-    layer_mark_dirty(ring_layer);
-  }
-  if(top_line_t){
-    char *buffer = top_line_t->value->cstring;  //The value returned from the settings page is a cstring
+  /*
+  This function applies a message from the configuration page. The
+  phone only sends the settings that changed since its last message,
+  and they are applied as one transaction: collected into a copy of
+  the settings first, then stored with one write, with the colors
+  picked once, each line laid out once and the face marked dirty once
+  */
+  Tuple *telemetry_request_t = dict_find(iter, MESSAGE_KEY_telemetryRequest);
+  
+  telemetry_inbox(iter);
+  
+  Settings updated = settings;
+  for(Tuple *tuple = dict_read_first(iter); tuple; tuple = dict_read_next(iter))
+    apply_setting(&updated, tuple->key, tuple_int(tuple));
+  
+  bool colors_changed = (updated.color_setting != settings.color_setting) ||
+    !gcolor_equal(updated.bg_color, settings.bg_color) || !gcolor_equal(updated.fg_color, settings.fg_color);
+  bool line_one_changed = (updated.line_one_setting != settings.line_one_setting);
+  bool line_two_changed = (updated.line_two_setting != settings.line_two_setting);
+  bool power_saving_changed = (updated.power_save_battery != settings.power_save_battery) ||
+    (updated.quiet_hours != settings.quiet_hours) || (updated.quiet_start != settings.quiet_start) ||
+    (updated.quiet_end != settings.quiet_end);
+  bool seconds_ring_changed = (updated.seconds_ring != settings.seconds_ring);
+  bool reveal_lines_changed = (updated.reveal_lines != settings.reveal_lines);
+  bool center_line_changed = (updated.center_line_setting != settings.center_line_setting);
+  bool bt_icon_changed = (updated.bluetooth_icon != settings.bluetooth_icon);
+  bool changed = memcmp(&updated, &settings, sizeof(settings));
+  settings = updated;
+  
+  if(changed){
+    save_settings();
     
-    //The cstring is immediately converted to an integer
-    if(!strcmp(buffer, "digitalTime"))
-      line_one_setting = DIGITAL;
-    else if(!strcmp(buffer, "month"))
-      line_one_setting = MONTH;
-    else if(!strcmp(buffer, "date"))
-      line_one_setting = DATE;
-    else if(!strcmp(buffer, "weekday"))
-      line_one_setting = WEEKDAY;
-    else if(!strcmp(buffer, "monthDay"))
-      line_one_setting = MONTH_DATE;
-    else if(!strcmp(buffer, "dayMonth"))
-      line_one_setting = DATE_MONTH;
-    else if(!strcmp(buffer, "weekdayDate"))
-      line_one_setting = WEEKDAY_DATE;
-    else if(!strcmp(buffer, "steps"))
-      line_one_setting = STEPS;
-    else if(!strcmp(buffer, "meters"))
-      line_one_setting = METERS;
-    else if(!strcmp(buffer, "feet"))
-      line_one_setting = FEET;
-    else if(!strcmp(buffer, "calories"))
-      line_one_setting = CALORIES;
-      
-    //some extra information for layer manipulation
-    Layer *window_layer = window_get_root_layer(main_window);
-    GRect bounds = layer_get_bounds(window_layer);
-    GPoint center = GPoint(bounds.size.w/2, bounds.size.h/2);
-      
-    //The WEEKDAY_DATE setting is too large to fit, so its font size must be reduced and its layer must be adjusted!  
-    if(line_one_setting == WEEKDAY_DATE){
-      text_layer_set_font(line_one_layer, fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD));
-      layer_set_frame(text_layer_get_layer(line_one_layer), GRect(
-        center.x - bounds.size.w/6,
-        center.y - line_one_offset_small,
-        bounds.size.w/3,
-        line_one_offset_small));
-      layer_mark_dirty(text_layer_get_layer(line_one_layer));
-    }
-    else{
-      text_layer_set_font(line_one_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-      layer_set_frame(text_layer_get_layer(line_one_layer), GRect(
-        center.x - bounds.size.w/6,
-        center.y - line_one_offset,
-        bounds.size.w/3,
-        line_one_offset));
-      layer_mark_dirty(text_layer_get_layer(line_one_layer));
+    if(colors_changed){
+      schedule_colors();
+      update_colors();
     }
-      
-    persist_write_int(MESSAGE_KEY_topLineSetting, line_one_setting);
-    update_lines(line_one_setting, 0);
-  }
-  if(bottom_line_t){
-    char *buffer = bottom_line_t->value->cstring;  //The value returned from the settings page is a cstring
-    
-    //The cstring is immediately converted to an integer
-    if(!strcmp(buffer, "digitalTime"))
-      line_two_setting = DIGITAL;
-    else if(!strcmp(buffer, "month"))
-      line_two_setting = MONTH;
-    else if(!strcmp(buffer, "date"))
-      line_two_setting = DATE;
-    else if(!strcmp(buffer, "weekday"))
-      line_two_setting = WEEKDAY;
-    else if(!strcmp(buffer, "monthDay"))
-      line_two_setting = MONTH_DATE;
-    else if(!strcmp(buffer, "dayMonth"))
-      line_two_setting = DATE_MONTH;
-    else if(!strcmp(buffer, "weekdayDate"))
-      line_two_setting = WEEKDAY_DATE;
-    else if(!strcmp(buffer, "steps"))
-      line_two_setting = STEPS;
-    else if(!strcmp(buffer, "meters"))
-      line_two_setting = METERS;
-    else if(!strcmp(buffer, "feet"))
-      line_two_setting = FEET;
-    else if(!strcmp(buffer, "calories"))
-      line_two_setting = CALORIES;
-    
-    //some extra information for layer manipulation
-    Layer *window_layer = window_get_root_layer(main_window);
-    GRect bounds = layer_get_bounds(window_layer);
-    GPoint center = GPoint(bounds.size.w/2, bounds.size.h/2);
-      
-    //The WEEKDAY_DATE setting is too large to fit, so its font size must be reduced and its layer must be adjusted!  
-    if(line_two_setting == WEEKDAY_DATE){
-      text_layer_set_font(line_two_layer, fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD));
-      layer_set_frame(text_layer_get_layer(line_two_layer), GRect(
-        center.x - bounds.size.w/6,
-        center.y - line_two_offset_small,
-        bounds.size.w/3,
-        bounds.size.w/6));
-      layer_mark_dirty(text_layer_get_layer(line_two_layer));
+    if(line_one_changed){
+      layout_line_layer(settings.line_one_setting, 0);
+      line_health_valid[0] = false;
+      update_lines(settings.line_one_setting, 0);
     }
-    else{
-      text_layer_set_font(line_two_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-      layer_set_frame(text_layer_get_layer(line_two_layer), GRect(
-        center.x - bounds.size.w/6,
-        center.y - line_two_offset,
-        bounds.size.w/3,
-        bounds.size.w/6));
-      layer_mark_dirty(text_layer_get_layer(line_two_layer));
+    if(line_two_changed){
+      layout_line_layer(settings.line_two_setting, 1);
+      line_health_valid[1] = false;
+      update_lines(settings.line_two_setting, 1);
     }
-      
-    persist_write_int(MESSAGE_KEY_bottomLineSetting, line_two_setting);
-    update_lines(line_two_setting, 1);
-  }
-  if(center_line_t){
-    char *buffer = center_line_t->value->cstring;  //The value returned from the settings page is a cstring
+    telemetry_enable(settings.telemetry);
+    if(seconds_ring_changed || reveal_lines_changed)
+      accel_tap_enable(true);
+    if(reveal_lines_changed)
+      reveal_lines_enable(true);
+    if(power_saving_changed)
+      update_power_saving();
     
-    //The cstring is immediately converted to an integer
-    if(!strcmp(buffer, "battery"))
-      center_line_setting = BATTERY;
-    else if(!strcmp(buffer, "constant"))
-      center_line_setting = CONSTANT;
-    else if(!strcmp(buffer, "none"))
-      center_line_setting = NONE;
-      
-    persist_write_int(MESSAGE_KEY_centerLineSetting, center_line_setting);
-    layer_mark_dirty(battery_layer);
-  }
-  if(bluetooth_vibes_t){
-    bluetooth_vibes_bool = bluetooth_vibes_t->value->uint8;
-    persist_write_bool(MESSAGE_KEY_bluetoothVibes, bluetooth_vibes_bool);
-  }
-  if(bluetooth_icon_t){
-    bluetooth_icon_bool = bluetooth_icon_t->value->uint8;
-    persist_write_bool(MESSAGE_KEY_bluetoothIcon, bluetooth_icon_bool);
+    //the center line and the bluetooth icon read their settings when drawn
+    if(center_line_changed)
+      redraw(ELEMENT_BATTERY, REDRAW_SETTINGS);
+    if(bt_icon_changed)
+      redraw(ELEMENT_BT_ICON, REDRAW_SETTINGS);
   }
+  
+  if(telemetry_request_t)
+    telemetry_send_summary();
+}
+
+static void position_bt_icon_layer(void){
+  /*
+  This function fits the bluetooth icon layer tightly around the icon's
+  circle, centered in the part of the screen that is not obstructed
+  */
+  GRect unobstructed_bounds = layer_get_unobstructed_bounds(window_get_root_layer(main_window));
+  GPoint center = GPoint(unobstructed_bounds.origin.x + unobstructed_bounds.size.w/2,
+                         unobstructed_bounds.origin.y + unobstructed_bounds.size.h/2);
+  int16_t radius = layout.bt_icon_radius;
+  
+  layer_set_frame(bt_icon_layer, GRect(center.x - radius, center.y - radius, 2*radius + 1, 2*radius + 1));
 }
 
 static void unobstructed_will_change(GRect final_unobstructed_screen_area, void *context){
   Layer *window_layer = window_get_root_layer(main_window);
   GRect full_bounds = layer_get_bounds(window_layer);
+  GRect start_bounds = layer_get_unobstructed_bounds(window_layer);
   
-  if(!grect_equal(&full_bounds, &final_unobstructed_screen_area)){ //screen is about to be obstructed, hide text for now
-    layer_set_hidden(text_layer_get_layer(line_one_layer), true);
-    layer_set_hidden(text_layer_get_layer(line_two_layer), true);
+  //the rings are drawn once at the obstructed size and moved along with the animation
+  ring_transition = true;
+  transition_bounds = (final_unobstructed_screen_area.size.h < start_bounds.size.h) ?
+    final_unobstructed_screen_area : start_bounds;
+  
+  obstructed = !grect_equal(&full_bounds, &final_unobstructed_screen_area);
+  if(obstructed){ //screen is about to be obstructed, hide text and stop the seconds ring for now
+    seconds_ring_stop();
+    layer_set_hidden(line_one_layer, true);
+    layer_set_hidden(line_two_layer, true);
     layer_set_hidden(battery_layer, true);
   }
+  invalidate_ring_cache();
+}
+
+static void unobstructed_change(AnimationProgress progress, void *context){
+  //the icon follows the center of the shrinking or growing unobstructed area
+  position_bt_icon_layer();
 }
 
 static void unobstructed_did_change(void *context){
@@ -540,44 +2221,163 @@ static void unobstructed_did_change(void *context){
   GRect full_bounds = layer_get_bounds(window_layer);
   GRect unobstructed_bounds = layer_get_unobstructed_bounds(window_layer);
   
-  if(grect_equal(&full_bounds, &unobstructed_bounds)){ //screen is no longer obstructed, redraw everything
-    layer_set_hidden(text_layer_get_layer(line_one_layer), false);
-    layer_set_hidden(text_layer_get_layer(line_two_layer), false);
+  ring_transition = false;
+  obstructed = !grect_equal(&full_bounds, &unobstructed_bounds);
+  if(!obstructed){ //screen is no longer obstructed, redraw everything
+    reveal_lines_show(lines_shown());
     layer_set_hidden(battery_layer, false);
   }
+  position_bt_icon_layer();
+  //the rings are drawn again at their final size, which hiding or showing layers does not always ask for
+  invalidate_ring_cache();
+  redraw(ELEMENT_RING, REDRAW_LAYOUT);
 }
 
-static void window_load(Window *window){
+static bool health_line(int setting){
+  //health lines need the health service, every other line only the clock
+  return (setting >= 0) && (setting < num_complications) &&
+    (complication_providers[setting].cadence == CADENCE_HEALTH);
+}
+
+static void save_snapshot(void){
+  /*
+  This function stores what the face shows as it unloads, so the next
+  load can show it again before asking any service. Nothing is written
+  if it matches the stored snapshot in all but its time, which then
+  still tells the next load when the palette and lines were current
+  */
+  //cleared first, so the padding and the ends of the strings compare equal too
+  Snapshot snapshot;
+  memset(&snapshot, 0, sizeof(snapshot));
+  snapshot.version = SNAPSHOT_VERSION;
+  snapshot.color_setting = settings.color_setting;
+  snapshot.palette_hour = palette_hour;
+  snapshot.battery_level = battery_level;
+  snapshot.battery_charging = battery_charging;
+  snapshot.bt_connected = bt_connected;
+  snapshot.power_saving = power_saving;
+  snapshot.line_settings[0] = settings.line_one_setting;
+  snapshot.line_settings[1] = settings.line_two_setting;
+  memcpy(snapshot.palette_schedule, palette_schedule, sizeof(palette_schedule));
+  strcpy(snapshot.line_text[0], line_texts[0].text);
+  strcpy(snapshot.line_text[1], line_texts[1].text);
   
-  //Loading all settings from persistant storage
-  if(persist_exists(MESSAGE_KEY_backgroundColor)){
-    int background_color_HEX = persist_read_int(MESSAGE_KEY_backgroundColor);
-    bg_color_settings = GColorFromHEX(background_color_HEX);
-  }
-  else{
-    bg_color_settings = GColorBlue;
-    
+  if(snapshot_stored){
+    snapshot.saved_at = stored_snapshot.saved_at;
+    if(memcmp(&snapshot, &stored_snapshot, sizeof(snapshot)) == 0)
+      return;
   }
-  if(persist_exists(MESSAGE_KEY_foregroundColor)){
-    int foreground_color_HEX = persist_read_int(MESSAGE_KEY_foregroundColor);
-    fg_color_settings = GColorFromHEX(foreground_color_HEX);
+  snapshot.saved_at = time(NULL);
+  persist_write_data(SNAPSHOT_KEY, &snapshot, sizeof(snapshot));
+  stored_snapshot = snapshot;
+  snapshot_stored = true;
+  
+  TelemetrySlot *slot = telemetry_current();
+  if(slot) telemetry_add(&slot->persist_writes, 1);
+}
+
+static bool restore_snapshot(void){
+  /*
+  This function puts the face back the way it was last shown, as far
+  as that still holds. The palette carries on from the hour it was at
+  instead of being picked again, the battery and connection are taken
+  as they were, and a health line keeps its text on the same day.
+  Returns false when there is no snapshot to start from
+  */
+  Snapshot snapshot;
+  snapshot_stored = false;
+  if((persist_read_data(SNAPSHOT_KEY, &snapshot, sizeof(snapshot)) != (int)sizeof(snapshot)) ||
+     (snapshot.version != SNAPSHOT_VERSION))
+    return false;
+  stored_snapshot = snapshot;
+  snapshot_stored = true;
+  
+  time_t now = time(NULL);
+  time_t saved_at = snapshot.saved_at;
+  bool same_day = (now >= saved_at) && (now - saved_at < SECONDS_PER_DAY) &&
+    (localtime(&saved_at)->tm_yday == time_context.tm.tm_yday);
+  
+  //the schedule only holds for the color setting it was picked for
+  if(snapshot.color_setting == settings.color_setting){
+    memcpy(palette_schedule, snapshot.palette_schedule, sizeof(palette_schedule));
+    palette_hour = snapshot.palette_hour;
+    //the hours that went by unloaded still count, as the ticks count them
+    int32_t hours = (now >= saved_at) ? (now / SECONDS_PER_HOUR - saved_at / SECONDS_PER_HOUR) : 0;
+    if(settings.color_setting == SELECTED_COLORS)
+      hours = 0;
+    if(palette_hour + hours >= palette_hours){
+      schedule_colors();
+    }
+    else{
+      palette_hour += hours;
+      set_colors();
+    }
   }
   else{
-    fg_color_settings = GColorWhite;
+    schedule_colors();
   }
-  color_setting = (persist_exists(MESSAGE_KEY_colorSetting)) ? persist_read_int(MESSAGE_KEY_colorSetting) : DARK;
-  line_one_setting = (persist_exists(MESSAGE_KEY_topLineSetting)) ? persist_read_int(MESSAGE_KEY_topLineSetting) : MONTH_DATE;
-  line_two_setting = (persist_exists(MESSAGE_KEY_bottomLineSetting)) ? persist_read_int(MESSAGE_KEY_bottomLineSetting) : STEPS;
-  center_line_setting = (persist_exists(MESSAGE_KEY_centerLineSetting)) ? persist_read_int(MESSAGE_KEY_centerLineSetting) : BATTERY;
-  bluetooth_vibes_bool = (persist_exists(MESSAGE_KEY_bluetoothVibes)) ? persist_read_bool(MESSAGE_KEY_bluetoothVibes) : true;//vibrate
-  bluetooth_icon_bool = (persist_exists(MESSAGE_KEY_bluetoothIcon)) ? persist_read_bool(MESSAGE_KEY_bluetoothIcon) : true;//show
   
-  //with all settings loaded, the global color variables can be set
-  set_colors();
+  battery_level = snapshot.battery_level;
+  battery_charging = snapshot.battery_charging;
+  bt_connected = snapshot.bt_connected;
+  //nothing is drawn yet, so the mode is taken over without what switching it does
+  power_saving = snapshot.power_saving;
+  
+  uint8_t line_settings[2] = { settings.line_one_setting, settings.line_two_setting };
+  for(int layer = 0; layer < 2; layer++){
+    bool holds = (snapshot.line_settings[layer] == line_settings[layer]) &&
+      ((!health_line(line_settings[layer])) || same_day);
+    snapshot.line_text[layer][sizeof(snapshot.line_text[layer]) - 1] = '\0';
+    strcpy(line_texts[layer].text, holds ? snapshot.line_text[layer] : "");
+  }
+  return true;
+}
+
+static void cold_start_refresh(void *data){
+  /*
+  This timer callback asks the services what the snapshot stood in for,
+  once the first frame is out. The battery and connection callbacks
+  only run when something changed while the face was unloaded, so an
+  unchanged state costs no redraw, and a connection that was already
+  lost is not vibrated for again
+  */
+  cold_start_timer = NULL;
+  
+  BatteryChargeState battery = battery_state_service_peek();
+  if((battery.charge_percent != battery_level) || ((battery.is_charging || battery.is_plugged) != battery_charging))
+    battery_callback(battery);
+  else
+    update_power_saving();
+  
+  bool connected = connection_service_peek_pebble_app_connection();
+  if(connected != bt_connected)
+    bluetooth_callback(connected);
+  
+  //the other lines were brought up to date at load
+  if(health_line(settings.line_one_setting))
+    update_lines(settings.line_one_setting, 0);
+  if(health_line(settings.line_two_setting))
+    update_lines(settings.line_two_setting, 1);
+}
+
+static void window_load(Window *window){
+  
+  //Loading all settings from persistant storage
+  load_settings();
+  
+  //everything is shown at the time of loading until the first tick, as if a day had just begun
+  time_t now = time(NULL);
+  time_context_set(localtime(&now), MINUTE_UNIT | DAY_UNIT);
+  telemetry_enable(settings.telemetry);
+  accel_tap_enable(true);
+  
+  //the last face shown comes back first; without one, the colors for the coming hours are picked
+  bool restored = restore_snapshot();
+  if(!restored)
+    schedule_colors();
   
   Layer *window_layer = window_get_root_layer(window);
   GRect bounds = layer_get_bounds(window_layer);
-  GPoint center = GPoint(bounds.size.w/2, bounds.size.h/2);
   
   window_set_background_color(main_window, background_color);
   
@@ -585,76 +2385,120 @@ static void window_load(Window *window){
   layer_set_update_proc(ring_layer, ring_update_proc);
   layer_add_child(window_layer, ring_layer);
    
-  //The layer's bounds are dependent on what it is displaying
-  line_one_layer = text_layer_create(GRect(
-    center.x - bounds.size.w/6,
-    center.y - ((line_one_setting == WEEKDAY_DATE) ? line_one_offset_small : line_one_offset),
-    bounds.size.w/3,
-    ((line_one_setting == WEEKDAY_DATE) ? line_one_offset_small : line_one_offset)
-  ));
-  text_layer_set_text_color(line_one_layer, foreground_color);
-  text_layer_set_background_color(line_one_layer, GColorClear);
-   //text font must be smaller for WEEKDAY_DATE
-    text_layer_set_font(line_one_layer, 
-                        fonts_get_system_font((line_one_setting == WEEKDAY_DATE) ? FONT_KEY_GOTHIC_14_BOLD : FONT_KEY_GOTHIC_18_BOLD));
-  text_layer_set_text_alignment(line_one_layer, GTextAlignmentCenter);
-  layer_add_child(window_layer, text_layer_get_layer(line_one_layer));
-  
-  //The layer's bounds are dependent on what it is displaying
-  line_two_layer = text_layer_create(GRect(
-    center.x - bounds.size.w/6,
-    center.y - ((line_two_setting == WEEKDAY_DATE) ? line_two_offset_small : line_two_offset),
-    bounds.size.w/3,
-    bounds.size.w/6
-  ));
-  text_layer_set_text_color(line_two_layer, foreground_color);
-  text_layer_set_background_color(line_two_layer, GColorClear);
-   //text font must be smaller for WEEKDAY_DATE
-    text_layer_set_font(line_two_layer, 
-                        fonts_get_system_font((line_two_setting == WEEKDAY_DATE) ? FONT_KEY_GOTHIC_14_BOLD : FONT_KEY_GOTHIC_18_BOLD));
-  text_layer_set_text_alignment(line_two_layer, GTextAlignmentCenter);
-  layer_add_child(window_layer, text_layer_get_layer(line_two_layer));
-  
-  battery_layer = layer_create(bounds);
+  //The layer's bounds and font are dependent on what it is displaying
+  line_one_layer = layer_create(GRectZero);
+  layer_set_update_proc(line_one_layer, line_update_proc);
+  layout_line_layer(settings.line_one_setting, 0);
+  layer_add_child(window_layer, line_one_layer);
+  
+  //The layer's bounds and font are dependent on what it is displaying
+  line_two_layer = layer_create(GRectZero);
+  layer_set_update_proc(line_two_layer, line_update_proc);
+  layout_line_layer(settings.line_two_setting, 1);
+  layer_add_child(window_layer, line_two_layer);
+  
+  //with reveal_lines on, the lines start out hidden
+  reveal_lines_enable(true);
+  
+  battery_layer = layer_create(layout.center_bar_frame);
   layer_set_update_proc(battery_layer, battery_update_proc);
   layer_add_child(window_layer, battery_layer);
   
-  bt_icon_layer = layer_create(bounds);
+  //sized and placed around the icon's circle by position_bt_icon_layer
+  bt_icon_layer = layer_create(GRectZero);
   layer_set_update_proc(bt_icon_layer, bt_icon_update_proc);
   layer_add_child(window_layer, bt_icon_layer);
+  position_bt_icon_layer();
   
   //update for 4.0 unobstructed API
   UnobstructedAreaHandlers unobstructed_handlers = {
     .will_change = unobstructed_will_change,
+    .change = unobstructed_change,
     .did_change = unobstructed_did_change
   };
   unobstructed_area_service_subscribe(unobstructed_handlers, NULL);
   
-  //these callbacks are run so they are accurate from load time
-  bluetooth_callback(connection_service_peek_pebble_app_connection());
-  battery_callback(battery_state_service_peek());
+  //the new text layers have to be filled in whatever the health values are
+  line_health_valid[0] = false;
+  line_health_valid[1] = false;
+  invalidate_health_values();
   
-  time_t now = time(NULL);
-  struct tm *t = localtime(&now);
-  tick_handler(t, MINUTE_UNIT);
+  if(restored){
+    //lines on the clock are cheap to bring up to date, everything else waits for the first frame
+    if(!health_line(settings.line_one_setting))
+      update_lines(settings.line_one_setting, 0);
+    if(!health_line(settings.line_two_setting))
+      update_lines(settings.line_two_setting, 1);
+    cold_start_pending = true;
+  }
+  else{
+    //these callbacks are run so they are accurate from load time
+    bluetooth_callback(connection_service_peek_pebble_app_connection());
+    battery_callback(battery_state_service_peek());
+    
+    //every complication has to be filled in
+    struct tm loaded = time_context.tm;
+    tick_handler(&loaded, time_context.crossed);
+  }
+  
+  //a window being pushed is drawn whole, whatever was asked for while loading
+  redraw_cancel();
+  
+  APP_LOG(APP_LOG_LEVEL_INFO, "heap after load: %d used, %d free", (int)heap_bytes_used(), (int)heap_bytes_free());
+  accounting_checkpoint(HEAP_LOADED);
 }
 
 static void window_unload(Window *window){
+  //what is shown now is what the next load starts from
+  save_snapshot();
+  cold_start_pending = false;
+  if(cold_start_timer)
+    app_timer_cancel(cold_start_timer);
+  cold_start_timer = NULL;
+  if(bt_debounce_timer)
+    app_timer_cancel(bt_debounce_timer);
+  bt_debounce_timer = NULL;
+  accel_tap_enable(false);
+  reveal_lines_enable(false);
+  //last, as stopping the seconds ring asks for a redraw of the ring destroyed below
+  redraw_cancel();
+  
   //sweet destruction
   layer_destroy(battery_layer);
+  layer_destroy(bt_icon_layer);
   layer_destroy(ring_layer);
-  text_layer_destroy(line_one_layer);
-  text_layer_destroy(line_two_layer);
+  layer_destroy(line_one_layer);
+  layer_destroy(line_two_layer);
+  
+  free(ring_cache);
+  ring_cache = NULL;
+  invalidate_ring_cache();
+  ring_spans_destroy(&ring_spans[0]);
+  ring_spans_destroy(&ring_spans[1]);
+  invalidate_sprites();
+  for(int small = 0; small < 2; small++){
+    if(glyph_atlases[small].bitmap) gbitmap_destroy(glyph_atlases[small].bitmap);
+    glyph_atlases[small].bitmap = NULL;
+  }
+  
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "health queries: %d made, %d skipped; text relayouts skipped: %d",
+          (int)health_queries, (int)health_queries_skipped, (int)text_relayouts_skipped);
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "bluetooth: %d flaps ignored, %d vibrations saved", (int)bt_flaps, (int)bt_vibes_saved);
+  
+  //every layer and bitmap of the window should be gone by now
+  accounting_checkpoint(HEAP_UNLOADED);
+  accounting_report("after unload");
 }
 
 static void init(void){
+  accounting_checkpoint(HEAP_INIT);
   srand(time(NULL));
   
   //subscribing to the necesary services
   tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);
   battery_state_service_subscribe(battery_callback);
   connection_service_subscribe((ConnectionHandlers){
-    .pebble_app_connection_handler = bluetooth_callback
+    .pebble_app_connection_handler = bluetooth_handler
   });
   
   main_window = window_create();
@@ -666,16 +2510,30 @@ static void init(void){
   
   window_stack_push(main_window, true);
   
+  //health values are cached and only re-read when the health service reports new data
+#if defined(PBL_HEALTH)
+  health_events_subscribed = health_service_events_subscribe(health_handler, NULL);
+#endif
+  
   //data from appmessage is not registered as freed
   app_message_register_inbox_received(inbox_received_handler);
-  app_message_open(128, 0);
+  //the inbox fits every setting at once; the outbox only ever carries the telemetry summary
+  app_message_open(settings_inbox_size, dict_calc_buffer_size(1, telemetry_summary_size));
 }
 
 static void deinit(void){
   tick_timer_service_unsubscribe();
   battery_state_service_unsubscribe();
   connection_service_unsubscribe();
+#if defined(PBL_HEALTH)
+  if(health_events_subscribed)
+    health_service_events_unsubscribe();
+#endif
   window_destroy(main_window);
+  telemetry_unload();
+  
+  accounting_checkpoint(HEAP_DEINIT);
+  accounting_report("after deinit");
 }
 
 int main(void){
@@ -0,0 +1,295 @@
+#include <pebble.h>
+#include "ring_spans.h"
+
+/*
+All geometry is worked out in half pixels from the ring's center, which
+sits on a pixel corner or a pixel center depending on the bounds, so it
+stays in integers. A pixel belongs to the ring when the distance of its
+center lies between the inner and outer radius, which is how
+graphics_fill_radial fills a ring without antialiasing. Each row of a
+table holds four half widths, the largest horizontal distance from the
+center still inside a circle: the hole (half a pixel inside the inner
+radius), where the inner edge ends (half a pixel outside it), where the
+outer edge starts (half a pixel inside the outer radius) and the outer
+edge (half a pixel outside it). Pixels between the inner and outer edge
+are covered fully and are written a word at a time; only the pixels in
+the two edges need their coverage worked out
+*/
+
+enum { SPAN_HOLE, SPAN_INNER, SPAN_OUTER, SPAN_EDGE, num_span_widths };
+
+#define num_coverage_levels 4  //edge pixels are blended in quarters
+#define no_limit        0x7fff
+
+typedef uint32_t __attribute__((may_alias)) SpanWord;
+
+typedef struct {
+  int16_t lo, hi;
+} Run;
+
+typedef struct {
+  bool full;
+  bool wide;                     //more than half a turn
+  int32_t start_cos, start_sin;
+  int32_t end_cos, end_sin;
+} Sector;
+
+static int32_t floor_div(int32_t a, int32_t b){
+  int32_t q = a / b;
+  return ((a % b != 0) && ((a < 0) != (b < 0))) ? q - 1 : q;
+}
+
+static int32_t ceil_div(int32_t a, int32_t b){
+  return -floor_div(-a, b);
+}
+
+static int32_t isqrt(int32_t value){
+  //integer square root, rounded down
+  int32_t root = 0, bit = 1 << 30;
+  while(bit > value) bit >>= 2;
+  while(bit){
+    if(value >= root + bit){
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else{
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+static int16_t half_width(int32_t radius, int32_t y2){
+  //-1 when the row misses the circle
+  if((radius < 0) || (y2*y2 > radius*radius))
+    return -1;
+  return isqrt(radius*radius - y2*y2);
+}
+
+static Run pixel_run(int32_t center_x2, int16_t width){
+  //pixels whose centers lie within width half pixels of the center, empty when lo > hi
+  if(width < 0)
+    return (Run){ no_limit, -no_limit };
+  return (Run){ ceil_div(center_x2 - width, 2), floor_div(center_x2 + width, 2) };
+}
+
+static int16_t first_row(GSize size){
+  //row of the ring's topmost edge pixel, relative to its bounds
+  int16_t diameter = (size.w < size.h) ? size.w : size.h;
+  return ceil_div(size.h - 2 - diameter, 2);
+}
+
+bool ring_spans_build(RingSpans *spans, GSize size, uint16_t thickness){
+  /*
+  This function works out the table for a ring, and only does so when
+  the ring's size or thickness changed since it was last built
+  */
+  if(spans->rows && gsize_equal(&spans->size, &size) && (spans->thickness == thickness))
+    return true;
+
+  int16_t diameter = (size.w < size.h) ? size.w : size.h;
+  int32_t outer = diameter;
+  int32_t inner = (diameter > 2*thickness) ? diameter - 2*thickness : 0;
+  int16_t top = first_row(size);
+  int16_t num_rows = floor_div(size.h + diameter, 2) - top + 1;
+
+  int16_t *rows = realloc(spans->rows, num_rows * num_span_widths * sizeof(int16_t));
+  if(!rows)
+    return false;
+
+  for(int16_t row = 0; row < num_rows; row++){
+    int32_t y2 = 2*(top + row) - (size.h - 1);
+    int16_t *widths = &rows[row * num_span_widths];
+    widths[SPAN_HOLE] = half_width(inner - 1, y2);
+    widths[SPAN_INNER] = half_width(inner + 1, y2);
+    widths[SPAN_OUTER] = half_width(outer - 1, y2);
+    widths[SPAN_EDGE] = half_width(outer + 1, y2);
+  }
+
+  spans->rows = rows;
+  spans->num_rows = num_rows;
+  spans->size = size;
+  spans->thickness = thickness;
+  return true;
+}
+
+void ring_spans_destroy(RingSpans *spans){
+  free(spans->rows);
+  spans->rows = NULL;
+}
+
+static Run half_plane(int32_t a, int32_t b, int32_t center_x2){
+  //pixels of a row with (2x - center_x2)*a >= b
+  if(a > 0)
+    return (Run){ ceil_div(ceil_div(b, a) + center_x2, 2), no_limit };
+  if(a < 0)
+    return (Run){ -no_limit, floor_div(floor_div(b, a) + center_x2, 2) };
+  return (b <= 0) ? (Run){ -no_limit, no_limit } : (Run){ no_limit, -no_limit };
+}
+
+static int sector_runs(const Sector *sector, int32_t y2, int32_t center_x2, Run runs[2]){
+  /*
+  This function returns the runs of a row that lie in the sector. A
+  pixel is clockwise of the start when x*cos(start) + y*sin(start) >= 0,
+  and anticlockwise of the end when x*cos(end) + y*sin(end) <= 0. A
+  sector of up to half a turn needs both, a wider one either
+  */
+  if(sector->full){
+    runs[0] = (Run){ -no_limit, no_limit };
+    return 1;
+  }
+  Run start = half_plane(sector->start_cos, -y2*sector->start_sin, center_x2);
+  Run end = half_plane(-sector->end_cos, y2*sector->end_sin, center_x2);
+
+  if(!sector->wide){
+    runs[0].lo = (start.lo > end.lo) ? start.lo : end.lo;
+    runs[0].hi = (start.hi < end.hi) ? start.hi : end.hi;
+    return (runs[0].lo <= runs[0].hi) ? 1 : 0;
+  }
+
+  int count = 0;
+  if(start.lo <= start.hi) runs[count++] = start;
+  if(end.lo <= end.hi) runs[count++] = end;
+  if((count == 2) && (runs[0].lo <= runs[1].hi + 1) && (runs[1].lo <= runs[0].hi + 1)){
+    runs[0].lo = (runs[0].lo < runs[1].lo) ? runs[0].lo : runs[1].lo;
+    runs[0].hi = (runs[0].hi > runs[1].hi) ? runs[0].hi : runs[1].hi;
+    count = 1;
+  }
+  return count;
+}
+
+static void fill_words(uint8_t *row, int16_t lo, int16_t hi, uint8_t color){
+  //bytes up to a word boundary, then whole words, then the bytes left over
+  uint8_t *cursor = row + lo, *end = row + hi + 1;
+  while((cursor < end) && ((uintptr_t)cursor & 3))
+    *cursor++ = color;
+  SpanWord word = color * 0x01010101u;
+  for(; cursor + 4 <= end; cursor += 4)
+    *(SpanWord *)cursor = word;
+  while(cursor < end)
+    *cursor++ = color;
+}
+
+static int coverage_level(int32_t excess, int32_t radius2){
+  /*
+  This function turns how far a pixel center lies inside a circle
+  (radius squared minus distance squared, in half pixels) into a
+  coverage level, from half covered on the circle itself
+  */
+  if(radius2 <= 0)
+    return num_coverage_levels;
+  int32_t level = num_coverage_levels/2 + floor_div(2*excess + radius2, 2*radius2);
+  if(level < 0) return 0;
+  if(level > num_coverage_levels) return num_coverage_levels;
+  return level;
+}
+
+static void blend_pixel(uint8_t *pixel, int level, const uint8_t *levels){
+  //a pixel covered by two edges keeps the stronger coverage, so filling it again changes nothing
+  for(int current = num_coverage_levels; current > 0; current--){
+    if(*pixel == levels[current]){
+      if(current >= level) return;
+      break;
+    }
+  }
+  *pixel = levels[level];
+}
+
+void ring_spans_fill(const RingSpans *spans, GBitmap *frame_buffer, GPoint origin,
+                     GColor color, GColor background, bool antialiased,
+                     int32_t angle_start, int32_t angle_end){
+  if((angle_end <= angle_start) || !spans->rows)
+    return;
+
+  int16_t diameter = (spans->size.w < spans->size.h) ? spans->size.w : spans->size.h;
+  int32_t outer = diameter;
+  int32_t inner = (diameter > 2*spans->thickness) ? diameter - 2*spans->thickness : 0;
+  int32_t center_x2 = 2*origin.x + spans->size.w - 1;
+  int32_t center_y2 = 2*origin.y + spans->size.h - 1;
+  int16_t top = origin.y + first_row(spans->size);
+  GRect frame_bounds = gbitmap_get_bounds(frame_buffer);
+
+  Sector sector = {
+    .full = (angle_end - angle_start) >= TRIG_MAX_ANGLE,
+    .wide = (angle_end - angle_start) > TRIG_MAX_ANGLE/2,
+    .start_cos = cos_lookup(angle_start), .start_sin = sin_lookup(angle_start),
+    .end_cos = cos_lookup(angle_end), .end_sin = sin_lookup(angle_end)
+  };
+
+  //the colors of each coverage level, from the background to the ring's color
+  uint8_t levels[num_coverage_levels + 1];
+  for(int level = 0; level <= num_coverage_levels; level++){
+    int rest = num_coverage_levels - level;
+    GColor8 blend = { .argb = 0 };
+    blend.a = 3;
+    blend.r = (color.r*level + background.r*rest + num_coverage_levels/2) / num_coverage_levels;
+    blend.g = (color.g*level + background.g*rest + num_coverage_levels/2) / num_coverage_levels;
+    blend.b = (color.b*level + background.b*rest + num_coverage_levels/2) / num_coverage_levels;
+    levels[level] = blend.argb;
+  }
+
+  for(int16_t row = 0; row < spans->num_rows; row++){
+    int16_t y = top + row;
+    if((y < 0) || (y >= frame_bounds.size.h)) continue;
+
+    int32_t y2 = 2*y - center_y2;
+    const int16_t *widths = &spans->rows[row * num_span_widths];
+    Run edge = pixel_run(center_x2, widths[SPAN_EDGE]);
+    if(edge.lo > edge.hi) continue;
+    Run hole = pixel_run(center_x2, widths[SPAN_HOLE]);
+    Run full = pixel_run(center_x2, widths[SPAN_OUTER]);
+    Run inside = pixel_run(center_x2, widths[SPAN_INNER]);
+
+    //the row's ring pixels lie on either side of the hole
+    Run pieces[2];
+    int num_pieces = 0;
+    if(hole.lo > hole.hi){
+      pieces[num_pieces++] = edge;
+    }
+    else{
+      pieces[num_pieces++] = (Run){ edge.lo, hole.lo - 1 };
+      pieces[num_pieces++] = (Run){ hole.hi + 1, edge.hi };
+    }
+
+    Run runs[2];
+    int num_runs = sector_runs(&sector, y2, center_x2, runs);
+    GBitmapDataRowInfo info = gbitmap_get_data_row_info(frame_buffer, y);
+
+    for(int piece = 0; piece < num_pieces; piece++){
+      for(int run = 0; run < num_runs; run++){
+        int16_t lo = pieces[piece].lo, hi = pieces[piece].hi;
+        if(lo < runs[run].lo) lo = runs[run].lo;
+        if(hi > runs[run].hi) hi = runs[run].hi;
+        if(lo < info.min_x) lo = info.min_x;
+        if(hi > info.max_x) hi = info.max_x;
+
+        for(int16_t x = lo; x <= hi; ){
+          //fully covered: inside the outer edge and outside the inner one
+          if((x >= full.lo) && (x <= full.hi) && ((x < inside.lo) || (x > inside.hi))){
+            int16_t end = (x < inside.lo) ? inside.lo - 1 : full.hi;
+            if(end > full.hi) end = full.hi;
+            if(end > hi) end = hi;
+            fill_words(info.data, x, end, levels[num_coverage_levels]);
+            x = end + 1;
+            continue;
+          }
+
+          int32_t x2 = 2*x - center_x2;
+          int32_t distance2 = x2*x2 + y2*y2;
+          if(antialiased){
+            int outer_level = coverage_level(outer*outer - distance2, outer);
+            int inner_level = coverage_level(distance2 - inner*inner, inner);
+            int level = (outer_level < inner_level) ? outer_level : inner_level;
+            if(level)
+              blend_pixel(&info.data[x], level, levels);
+          }
+          else if((distance2 <= outer*outer) && (distance2 >= inner*inner)){
+            info.data[x] = levels[num_coverage_levels];
+          }
+          x++;
+        }
+      }
+    }
+  }
+}
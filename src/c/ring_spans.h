@@ -0,0 +1,28 @@
+#pragma once
+
+#include <pebble.h>
+
+/*
+A renderer for the face's rings that writes straight into an 8 bit
+framebuffer. The rings always have the same size and thickness, so each
+one gets a table of per-row extents, worked out once, and a fill only
+walks those rows and the spans the requested angles leave of them.
+Edge pixels along the circles are antialiased from a small coverage
+table; the angular ends of a fill are left sharp
+*/
+
+typedef struct {
+  GSize size;         //bounds the ring is fitted to, as for GOvalScaleModeFitCircle
+  uint16_t thickness;
+  int16_t num_rows;
+  int16_t *rows;      //per row, see ring_spans.c
+} RingSpans;
+
+//builds the table for a ring, or keeps the one already built for the same size and thickness
+bool ring_spans_build(RingSpans *spans, GSize size, uint16_t thickness);
+void ring_spans_destroy(RingSpans *spans);
+
+//fills the ring from angle_start to angle_end (TRIG_MAX_ANGLE units) with its bounds at origin
+void ring_spans_fill(const RingSpans *spans, GBitmap *frame_buffer, GPoint origin,
+                     GColor color, GColor background, bool antialiased,
+                     int32_t angle_start, int32_t angle_end);
@@ -1,3 +1,183 @@
 var Clay = require('pebble-clay');
 var clayConfig = require('./config');
-var clay = new Clay(clayConfig);
\ No newline at end of file
+var clay = new Clay(clayConfig, null, { autoHandleEvents: false });
+
+/*
+Settings are sent to the watch as single byte integers, and only those
+that changed since the watch last acknowledged a message. What the
+watch holds can change without the phone knowing (a reinstall, a
+restore, another phone), so each start forgets what was sent and the
+next save sends every setting again. The lists
+below give each select value its coded integer on the watch (the
+#defines at the top of main.c) and have to stay in the same order
+*/
+
+var COLOR_SETTINGS = ['selectedColors', 'trueRandom', 'dark', 'light', 'hot', 'cold'];
+var COMPLICATIONS = ['digitalTime', 'month', 'date', 'weekday', 'monthDay', 'dayMonth',
+                     'weekdayDate', 'steps', 'meters', 'feet', 'calories'];
+var CENTER_LINE_SETTINGS = ['battery', 'constant', 'none'];
+
+function encodeColor(value) {
+  //24 bit RGB to the watch's 8 bit GColor, two bits a channel
+  var rgb = typeof value === 'string' ? parseInt(value.replace(/^(#|0x)/, ''), 16) : value;
+  return 0xC0 | ((rgb >> 22) & 3) << 4 | ((rgb >> 14) & 3) << 2 | ((rgb >> 6) & 3);
+}
+
+function encodeChoice(choices) {
+  return function(value) {
+    return choices.indexOf(value);
+  };
+}
+
+function encodeNumber(value) {
+  return parseInt(value, 10);
+}
+
+function encodeBool(value) {
+  return value ? 1 : 0;
+}
+
+var SETTING_ENCODERS = {
+  colorSetting: encodeChoice(COLOR_SETTINGS),
+  backgroundColor: encodeColor,
+  foregroundColor: encodeColor,
+  topLineSetting: encodeChoice(COMPLICATIONS),
+  bottomLineSetting: encodeChoice(COMPLICATIONS),
+  centerLineSetting: encodeChoice(CENTER_LINE_SETTINGS),
+  bluetoothVibes: encodeBool,
+  bluetoothIcon: encodeBool,
+  powerSaveBattery: encodeNumber,
+  quietHours: encodeBool,
+  quietStart: encodeNumber,
+  quietEnd: encodeNumber,
+  telemetry: encodeBool,
+  secondsRing: encodeBool,
+  revealLines: encodeBool
+};
+
+function sendSettings() {
+  var settings = JSON.parse(localStorage.getItem('clay-settings') || '{}');
+  var sent = JSON.parse(localStorage.getItem('sent-settings') || '{}');
+  var message = {};
+  var changed = false;
+
+  Object.keys(SETTING_ENCODERS).forEach(function(key) {
+    if (!(key in settings)) {
+      return;
+    }
+    var value = SETTING_ENCODERS[key](settings[key]);
+    if (isNaN(value) || value < 0 || value > 255 || sent[key] === value) {
+      return;
+    }
+    //an array goes as a byte array, a plain number would take four bytes
+    message[key] = [value];
+    sent[key] = value;
+    changed = true;
+  });
+
+  if (!changed) {
+    return;
+  }
+  Pebble.sendAppMessage(message, function() {
+    localStorage.setItem('sent-settings', JSON.stringify(sent));
+  }, function() {
+    console.log('settings were not delivered, all of them are sent again next time');
+    localStorage.removeItem('sent-settings');
+  });
+}
+
+Pebble.addEventListener('ready', function() {
+  localStorage.removeItem('sent-settings');
+});
+
+Pebble.addEventListener('showConfiguration', function() {
+  requestTelemetry();
+  Pebble.openURL(clay.generateUrl());
+});
+
+Pebble.addEventListener('webviewclosed', function(e) {
+  if (!e || !e.response) {
+    return;
+  }
+  //stores the page's values in localStorage under 'clay-settings'
+  clay.getSettings(e.response);
+  sendSettings();
+});
+
+/*
+Telemetry is only recorded on the watch once the user opts in on the
+configuration page, and kept through relaunches. Each time the page
+is opened, the phone asks for a summary of the last day of activity.
+The summary is logged and the most recent ones are kept in
+localStorage under 'telemetry'
+*/
+
+var TELEMETRY_FORMAT = 3;
+var TELEMETRY_LAYERS = ['ring', 'battery', 'btIcon', 'lineOne', 'lineTwo'];
+var DRAW_TIME_BUCKETS = ['0ms', '1ms', '2-3ms', '4-7ms', '8-15ms', '16ms+'];
+var TELEMETRY_SLOTS = 24;
+var TELEMETRY_HISTORY = 48;
+
+function telemetryEnabled() {
+  var settings = JSON.parse(localStorage.getItem('clay-settings') || '{}');
+  return settings.telemetry === true;
+}
+
+function decodeTelemetry(bytes) {
+  var offset = 0;
+  function read(size) {
+    var value = 0;
+    for (var i = 0; i < size; i++) {
+      value += bytes[offset++] * Math.pow(256, i);
+    }
+    return value;
+  }
+
+  if (read(1) !== TELEMETRY_FORMAT) {
+    return null;
+  }
+  var summary = {
+    received: new Date().toISOString(),
+    hours: read(1),
+    layers: {},
+    drawTimeHistogram: {},
+    hourlyRedraws: []
+  };
+  TELEMETRY_LAYERS.forEach(function(layer) {
+    summary.layers[layer] = { redraws: read(4), drawMs: read(4), maxDrawMs: read(4) };
+  });
+  summary.healthQueries = read(4);
+  summary.persistWrites = read(4);
+  summary.inboxMessages = read(4);
+  summary.inboxBytes = read(4);
+  summary.bluetoothFlaps = read(4);
+  summary.bluetoothVibesSaved = read(4);
+  DRAW_TIME_BUCKETS.forEach(function(bucket) {
+    summary.drawTimeHistogram[bucket] = read(4);
+  });
+  for (var hour = 0; hour < TELEMETRY_SLOTS; hour++) {
+    summary.hourlyRedraws.push(read(2));
+  }
+  return summary;
+}
+
+function requestTelemetry() {
+  if (telemetryEnabled()) {
+    Pebble.sendAppMessage({ telemetryRequest: 1 });
+  }
+}
+
+Pebble.addEventListener('appmessage', function(e) {
+  if (!e.payload.telemetryData) {
+    return;
+  }
+  var summary = decodeTelemetry(e.payload.telemetryData);
+  if (!summary) {
+    return;
+  }
+  console.log('telemetry: ' + JSON.stringify(summary));
+
+  var history = JSON.parse(localStorage.getItem('telemetry') || '[]');
+  history.push(summary);
+  localStorage.setItem('telemetry', JSON.stringify(history.slice(-TELEMETRY_HISTORY)));
+});
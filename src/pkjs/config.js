@@ -1,6 +1,15 @@
 'use strict';
 /* eslint-disable quotes */
 
+//every hour of the day, for the quiet hours selects
+var hourOptions = [];
+for (var hour = 0; hour < 24; hour++) {
+  hourOptions.push({
+    "label": ((hour % 12) || 12) + (hour < 12 ? " AM" : " PM"),
+    "value": String(hour)
+  });
+}
+
 module.exports = [
   {
     "type": "heading",
@@ -179,6 +188,17 @@ module.exports = [
             "value": "calories"
           }
         ]
+      },
+      {
+        "type": "toggle",
+        "label": "Only show them after a flick of the wrist",
+        "messageKey": "revealLines",
+        "defaultValue": false
+      },
+      {
+        "type": "text",
+        "defaultValue":
+          "<font size=3>The face shows just the rings, and both lines for 5 seconds after a flick of the wrist. They are only worked out then, which saves battery</font>"
       }
     ]
   },
@@ -231,6 +251,89 @@ module.exports = [
       }
     ]
   },
+  {
+    "type": "section",
+    "items": [
+      {
+        "type": "heading",
+        "defaultValue": "Power Saving"
+      },
+      {
+        "type": "slider",
+        "label": "Save power below this battery level (0 is off)",
+        "messageKey": "powerSaveBattery",
+        "defaultValue": 20,
+        "min": 0,
+        "max": 50,
+        "step": 5
+      },
+      {
+        "type": "toggle",
+        "label": "Save power during quiet hours",
+        "messageKey": "quietHours",
+        "defaultValue": false
+      },
+      {
+        "type": "select",
+        "label": "Quiet hours start",
+        "messageKey": "quietStart",
+        "defaultValue": "22",
+        "options": hourOptions
+      },
+      {
+        "type": "select",
+        "label": "Quiet hours end",
+        "messageKey": "quietEnd",
+        "defaultValue": "7",
+        "options": hourOptions
+      },
+      {
+        "type": "text",
+        "defaultValue":
+          "<font size=3>While saving power (and while you sleep) the rings update every 5 minutes and colors stop changing</font>"
+      }
+    ]
+  },
+  {
+    "type": "section",
+    "items": [
+      {
+        "type": "heading",
+        "defaultValue": "Seconds"
+      },
+      {
+        "type": "toggle",
+        "label": "Show seconds after a flick of the wrist",
+        "messageKey": "secondsRing",
+        "defaultValue": false
+      },
+      {
+        "type": "text",
+        "defaultValue":
+          "<font size=3>A thin ring along the minute ring counts the seconds for 15 seconds, then the face goes back to updating once a minute</font>"
+      }
+    ]
+  },
+  {
+    "type": "section",
+    "items": [
+      {
+        "type": "heading",
+        "defaultValue": "Diagnostics"
+      },
+      {
+        "type": "toggle",
+        "label": "Record performance statistics",
+        "messageKey": "telemetry",
+        "defaultValue": false
+      },
+      {
+        "type": "text",
+        "defaultValue":
+          "<font size=3>Counts redraws, draw times and storage writes for the last 24 hours. The phone app collects them when the watchface starts</font>"
+      }
+    ]
+  },
   {
     "type": "submit",
     "defaultValue": "Save"